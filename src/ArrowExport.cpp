@@ -0,0 +1,225 @@
+#include "ArrowExport.h"
+
+// ################################################################################
+// ################################ Schema ########################################
+// ################################################################################
+
+// the strings and children of an exported schema
+struct SchemaData {
+  std::string format;
+  std::string name;
+  std::vector<ArrowSchema*> children;
+};
+
+static void releaseSchema(ArrowSchema* schema) {
+  SchemaData* data = static_cast<SchemaData*>(schema->private_data);
+  for (ArrowSchema* child : data->children) {
+    if (child->release != NULL) child->release(child);
+    delete child;
+  }
+  if (schema->dictionary != NULL) {
+    if (schema->dictionary->release != NULL) schema->dictionary->release(schema->dictionary);
+    delete schema->dictionary;
+  }
+  delete data;
+  schema->release = NULL;
+}
+
+/**
+ * @brief      Fills a schema, the strings are copied into the schema
+ *
+ * @param      schema     The schema
+ * @param[in]  format     The format of the type (see the Arrow C data interface)
+ * @param[in]  name       The name of the field
+ * @param[in]  nChildren  The number of children, which are allocated but not filled
+ */
+static void fillSchema(ArrowSchema* schema, std::string const& format, std::string const& name,
+                       unsigned long long nChildren) {
+  SchemaData* data = new SchemaData();
+  data->format = format;
+  data->name   = name;
+  for (unsigned long long i = 0; i < nChildren; ++i) data->children.push_back(new ArrowSchema());
+
+  schema->format       = data->format.c_str();
+  schema->name         = data->name.c_str();
+  schema->metadata     = NULL;
+  schema->flags        = ARROW_FLAG_NULLABLE;
+  schema->n_children   = nChildren;
+  schema->children     = nChildren > 0 ? data->children.data() : NULL;
+  schema->dictionary   = NULL;
+  schema->release      = releaseSchema;
+  schema->private_data = data;
+}
+
+// ################################################################################
+// ################################ Array #########################################
+// ################################################################################
+
+// the columns and children of an exported record batch
+struct BatchData {
+  std::vector<ArrowArray*> children;
+  const void* buffers[1] = {NULL};
+};
+
+static void releaseColumn(ArrowArray* array) {
+  if (array->dictionary != NULL) {
+    if (array->dictionary->release != NULL) array->dictionary->release(array->dictionary);
+    delete array->dictionary;
+  }
+  delete static_cast<ArrowColumn*>(array->private_data);
+  array->release = NULL;
+}
+
+/**
+ * @brief      Creates the array of a column, the array owns the column
+ *
+ * @param      column  The column
+ * @param[in]  nrow    The number of rows of the batch
+ *
+ * @return     The array
+ */
+static ArrowArray* exportColumn(ArrowColumn* column, unsigned long long nrow) {
+  ArrowArray* array = new ArrowArray();
+  array->length       = column->length < 0 ? (int64_t) nrow : column->length;
+  array->null_count   = column->nullCount;
+  array->offset       = 0;
+  array->n_buffers    = column->buffers.size();
+  array->n_children   = 0;
+  array->buffers      = column->buffers.data();
+  array->children     = NULL;
+  array->dictionary   = column->dictionary ? exportColumn(column->dictionary.release(), 0) : NULL;
+  array->release      = releaseColumn;
+  array->private_data = column;
+  return array;
+}
+
+static void releaseBatch(ArrowArray* array) {
+  BatchData* data = static_cast<BatchData*>(array->private_data);
+  for (ArrowArray* child : data->children) {
+    if (child->release != NULL) child->release(child);
+    delete child;
+  }
+  delete data;
+  array->release = NULL;
+}
+
+// ################################################################################
+// ################################ Stream ########################################
+// ################################################################################
+
+// the columns of the stream until the batch is exported
+struct StreamData {
+  unsigned long long nrow;
+  std::vector<std::string> names;
+  std::vector<std::string> formats;
+  std::vector<std::string> dictionaryFormats;
+  std::vector<std::unique_ptr<ArrowColumn>> columns;
+  bool exported = false;
+};
+
+static int getStreamSchema(ArrowArrayStream* stream, ArrowSchema* out) {
+  StreamData* data = static_cast<StreamData*>(stream->private_data);
+  fillSchema(out, "+s", "", data->names.size());
+  for (unsigned long long i = 0; i < data->names.size(); ++i) {
+    fillSchema(out->children[i], data->formats[i], data->names[i], 0);
+    if (!data->dictionaryFormats[i].empty()) {
+      out->children[i]->dictionary = new ArrowSchema();
+      fillSchema(out->children[i]->dictionary, data->dictionaryFormats[i], "", 0);
+    }
+  }
+  return 0;
+}
+
+static int getStreamNext(ArrowArrayStream* stream, ArrowArray* out) {
+  StreamData* data = static_cast<StreamData*>(stream->private_data);
+  // the end of the stream is a released array
+  out->release = NULL;
+  if (data->exported) return 0;
+
+  BatchData* batch = new BatchData();
+  for (auto& column : data->columns) {
+    batch->children.push_back(exportColumn(column.release(), data->nrow));
+  }
+  data->columns.clear();
+  data->exported = true;
+
+  out->length       = data->nrow;
+  out->null_count   = 0;
+  out->offset       = 0;
+  out->n_buffers    = 1;
+  out->n_children   = batch->children.size();
+  out->buffers      = batch->buffers;
+  out->children     = batch->children.empty() ? NULL : batch->children.data();
+  out->dictionary   = NULL;
+  out->release      = releaseBatch;
+  out->private_data = batch;
+  return 0;
+}
+
+static const char* getStreamError(ArrowArrayStream*) {
+  return NULL;
+}
+
+static void releaseStream(ArrowArrayStream* stream) {
+  delete static_cast<StreamData*>(stream->private_data);
+  stream->release = NULL;
+}
+
+/**
+ * @brief      Releases a stream that was not moved by a consumer, the finalizer of the external pointer
+ *
+ * @param      stream  The stream
+ */
+static void finalizeStream(ArrowArrayStream* stream) {
+  if (stream->release != NULL) stream->release(stream);
+  delete stream;
+}
+
+// ################################################################################
+// ################################ ArrowBuilder ##################################
+// ################################################################################
+
+/**
+ * @brief      Adds an empty column
+ *
+ * @param[in]  name              The name of the column
+ * @param[in]  format            The format of the type (see the Arrow C data interface)
+ * @param[in]  dictionaryFormat  The format of the dictionary, empty for columns without a dictionary
+ *
+ * @return     The column, the buffers are added after the validity bitmap
+ */
+ArrowColumn& ArrowBuilder::addColumn(const std::string& name, const std::string& format,
+                                     const std::string& dictionaryFormat) {
+  names.push_back(name);
+  formats.push_back(format);
+  dictionaryFormats.push_back(dictionaryFormat);
+  columns.emplace_back(new ArrowColumn());
+  columns.back()->buffers.push_back(NULL);
+  return *columns.back();
+}
+
+/**
+ * @brief      Moves the columns into an ArrowArrayStream with a single record batch
+ *
+ * @return     An external pointer (class "ritch_arrow_stream") to the stream,
+ *              the stream is released when it is garbage collected, unless a consumer moved it
+ */
+SEXP ArrowBuilder::build() {
+  StreamData* data = new StreamData();
+  data->nrow = nrow;
+  data->names.swap(names);
+  data->formats.swap(formats);
+  data->dictionaryFormats.swap(dictionaryFormats);
+  data->columns.swap(columns);
+
+  ArrowArrayStream* stream = new ArrowArrayStream();
+  stream->get_schema     = getStreamSchema;
+  stream->get_next       = getStreamNext;
+  stream->get_last_error = getStreamError;
+  stream->release        = releaseStream;
+  stream->private_data   = data;
+
+  Rcpp::XPtr<ArrowArrayStream, Rcpp::PreserveStorage, finalizeStream> ptr(stream, true);
+  ptr.attr("class") = "ritch_arrow_stream";
+  return ptr;
+}
@@ -0,0 +1,286 @@
+#ifndef ARROWEXPORT_H
+#define ARROWEXPORT_H
+
+#include <Rcpp.h>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MessageTypes.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * ArrowBuilder exports the content vectors of a MessageType as a single
+ *  record batch through the Arrow C stream interface
+ *  (https://arrow.apache.org/docs/format/CStreamInterface.html), thus
+ *  the bindings of arrow, duckdb, or polars take the columns without a copy.
+ *
+ * It has the functions of DataFrameBuilder, thus a MessageType adds the same
+ *  columns to both (see Orders::addColumns). The content vectors are moved
+ *  into the batch (the MessageType is empty afterwards) and are released
+ *  by the consumer:
+ *  - unsigned long long: int64 (moved, all values are below 2^63)
+ *  - double:             float64 (moved)
+ *  - other numbers:      int64 (copied)
+ *  - bool:               boolean (packed into bits)
+ *  - char:               large utf8, the characters are the data buffer (moved),
+ *                         only the offsets are created
+ *  - single-byte codes:  dictionary of the levels with int8 indices (factors in R),
+ *                         codes that are not a level are null
+ *  - alpha fields:       large utf8 without the trailing spaces (copied)
+ * #################################################################
+ */
+
+// the structs of the Arrow C data and stream interface (ABI stable)
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+  void (*release)(struct ArrowSchema*);
+  void* private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+  void (*release)(struct ArrowArray*);
+  void* private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+#ifndef ARROW_C_STREAM_INTERFACE
+#define ARROW_C_STREAM_INTERFACE
+
+struct ArrowArrayStream {
+  int (*get_schema)(struct ArrowArrayStream*, struct ArrowSchema* out);
+  int (*get_next)(struct ArrowArrayStream*, struct ArrowArray* out);
+  const char* (*get_last_error)(struct ArrowArrayStream*);
+  void (*release)(struct ArrowArrayStream*);
+  void* private_data;
+};
+
+#endif // ARROW_C_STREAM_INTERFACE
+
+// a buffer that is owned by a column, released with its array
+struct ArrowBuffer {
+  virtual ~ArrowBuffer() {}
+};
+
+template <typename V>
+struct OwnedBuffer : public ArrowBuffer {
+  V values;
+};
+
+// a column of the batch
+struct ArrowColumn {
+  std::vector<std::unique_ptr<ArrowBuffer>> owned;
+  std::vector<const void*> buffers; // the validity bitmap (NULL without nulls), then the data buffers
+  int64_t length    = -1;           // -1 for the number of rows of the batch
+  int64_t nullCount = 0;
+  std::unique_ptr<ArrowColumn> dictionary; // the levels of a factor
+};
+
+// the Arrow format of a numeric content vector that is moved into the batch
+template <typename T> struct ArrowNative            { static const bool moved = false; };
+template <> struct ArrowNative<unsigned long long> { static const bool moved = true; };
+template <> struct ArrowNative<long long>          { static const bool moved = true; };
+template <> struct ArrowNative<double>             { static const bool moved = true; };
+
+class ArrowBuilder {
+public:
+  explicit ArrowBuilder(unsigned long long nrow) : nrow(nrow) {}
+
+  // Functions
+  template <typename T, typename A>
+  void addNumeric(const std::string& name, std::vector<T, A>& x);
+  template <typename A>
+  void addLogical(const std::string& name, const std::vector<bool, A>& x);
+  template <typename A>
+  void addChar(const std::string& name, std::vector<char, A>& x);
+  template <typename A>
+  void addFactor(const std::string& name, const std::vector<char, A>& x,
+                 const std::vector<unsigned char>& levels);
+  template <typename T, typename A>
+  void addSymbol(const std::string& name, const std::vector<T, A>& x);
+  SEXP build();
+
+private:
+  ArrowColumn& addColumn(const std::string& name, const std::string& format,
+                         const std::string& dictionaryFormat = "");
+  template <typename V>
+  const void* own(ArrowColumn& column, V& values);
+
+  unsigned long long nrow;
+  std::vector<std::string> names;
+  std::vector<std::string> formats;
+  std::vector<std::string> dictionaryFormats; // empty for columns without a dictionary
+  std::vector<std::unique_ptr<ArrowColumn>> columns;
+};
+
+/**
+ * @brief      Moves a buffer into a column
+ *
+ * @param      column  The column
+ * @param      values  The values, empty afterwards
+ *
+ * @return     The address of the values
+ */
+template <typename V>
+const void* ArrowBuilder::own(ArrowColumn& column, V& values) {
+  OwnedBuffer<V>* buffer = new OwnedBuffer<V>();
+  column.owned.emplace_back(buffer);
+  buffer->values.swap(values);
+  return buffer->values.data();
+}
+
+/**
+ * @brief      Adds a numeric column, int64 and float64 content vectors are
+ *              moved into the batch, the others are copied into int64
+ *
+ * @param[in]  name  The name of the column
+ * @param      x     The content vector, empty afterwards if it is moved
+ */
+template <typename T, typename A>
+void ArrowBuilder::addNumeric(const std::string& name, std::vector<T, A>& x) {
+  if (ArrowNative<T>::moved) {
+    ArrowColumn& column = addColumn(name, std::is_floating_point<T>::value ? "g" : "l");
+    column.buffers.push_back(own(column, x));
+  } else {
+    std::vector<long long> values(x.begin(), x.end());
+    ArrowColumn& column = addColumn(name, "l");
+    column.buffers.push_back(own(column, values));
+  }
+}
+
+/**
+ * @brief      Adds a logical column, the values are packed into bits
+ *
+ * @param[in]  name  The name of the column
+ * @param[in]  x     The content vector
+ */
+template <typename A>
+void ArrowBuilder::addLogical(const std::string& name, const std::vector<bool, A>& x) {
+  std::vector<uint8_t> bits((x.size() + 7) / 8, 0);
+  for (unsigned long long i = 0; i < x.size(); ++i) {
+    if (x[i]) bits[i / 8] |= 1 << (i % 8);
+  }
+  ArrowColumn& column = addColumn(name, "b");
+  column.buffers.push_back(own(column, bits));
+}
+
+/**
+ * @brief      Adds a character column of single characters, the characters are moved
+ *              into the batch, unless there are empty values (0), which are left out
+ *
+ * @param[in]  name  The name of the column
+ * @param      x     The content vector, empty afterwards
+ */
+template <typename A>
+void ArrowBuilder::addChar(const std::string& name, std::vector<char, A>& x) {
+  std::vector<int64_t> offsets(x.size() + 1);
+  unsigned long long n = 0;
+  for (unsigned long long i = 0; i < x.size(); ++i) {
+    offsets[i] = n;
+    if (x[i] != 0) x[n++] = x[i];
+  }
+  offsets[x.size()] = n;
+  x.resize(n);
+
+  ArrowColumn& column = addColumn(name, "U");
+  column.buffers.push_back(own(column, offsets));
+  column.buffers.push_back(own(column, x));
+}
+
+/**
+ * @brief      Adds a factor column of single-byte codes, the codes are copied as 
+ *              int8 indices into a dictionary of the levels
+ *
+ * @param[in]  name    The name of the column
+ * @param[in]  x       The content vector
+ * @param[in]  levels  The levels of the factor (at most 127), codes that are not a level are null
+ */
+template <typename A>
+void ArrowBuilder::addFactor(const std::string& name, const std::vector<char, A>& x,
+                             const std::vector<unsigned char>& levels) {
+  int8_t codes[256];
+  std::fill(codes, codes + 256, -1);
+  std::vector<int32_t> levelOffsets(levels.size() + 1);
+  std::vector<char> levelChars(levels.begin(), levels.end());
+  for (unsigned long long i = 0; i < levels.size(); ++i) {
+    codes[levels[i]] = i;
+    levelOffsets[i + 1] = i + 1;
+  }
+
+  std::vector<int8_t> indices(x.size());
+  std::vector<uint8_t> valid((x.size() + 7) / 8, 0);
+  int64_t nullCount = 0;
+  for (unsigned long long i = 0; i < x.size(); ++i) {
+    const int8_t code = codes[(unsigned char) x[i]];
+    if (code < 0) {
+      ++nullCount;
+    } else {
+      indices[i] = code;
+      valid[i / 8] |= 1 << (i % 8);
+    }
+  }
+
+  ArrowColumn& column = addColumn(name, "c", "u");
+  column.nullCount = nullCount;
+  if (nullCount > 0) column.buffers[0] = own(column, valid);
+  column.buffers.push_back(own(column, indices));
+
+  column.dictionary.reset(new ArrowColumn());
+  ArrowColumn& dictionary = *column.dictionary;
+  dictionary.length = levels.size();
+  dictionary.buffers.push_back(NULL);
+  dictionary.buffers.push_back(own(dictionary, levelOffsets));
+  dictionary.buffers.push_back(own(dictionary, levelChars));
+}
+
+/**
+ * @brief      Adds a character column from raw ITCH alpha fields (i.e., stocks or MPIDs),
+ *              the width of the field is given by the size of T (8 or 4 characters)
+ *
+ * @param[in]  name  The name of the column
+ * @param[in]  x     The raw fields as returned by get8bytes or get4bytes
+ */
+template <typename T, typename A>
+void ArrowBuilder::addSymbol(const std::string& name, const std::vector<T, A>& x) {
+  const unsigned int nChars = sizeof(T);
+  std::vector<int64_t> offsets(x.size() + 1);
+  std::vector<char> chars(x.size() * nChars);
+  unsigned long long n = 0;
+  for (unsigned long long i = 0; i < x.size(); ++i) {
+    offsets[i] = n;
+    n += getSymbolChars(x[i], nChars, &chars[n]);
+  }
+  offsets[x.size()] = n;
+  chars.resize(n);
+
+  ArrowColumn& column = addColumn(name, "U");
+  column.buffers.push_back(own(column, offsets));
+  column.buffers.push_back(own(column, chars));
+}
+
+#endif //ARROWEXPORT_H
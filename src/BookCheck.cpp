@@ -0,0 +1,224 @@
+#include <Rcpp.h>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include "BookReplay.h"
+#include "DataFrameBuilder.h"
+#include "RITCH.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * BookCheck replays the orders of a file into the OrderBook and into a naive
+ *  book (std::map of the orders and of the price levels), the top of book of
+ *  both is compared after each message. Used by the tests (see inst/tinytest),
+ *  the naive book is also compared with the snapshots of write_book().
+ *
+ * The messages are replayed as in the loaders (see BookReplay), thus the
+ *  modifications are batched, the messages of a batch are still compared one by one.
+ * #################################################################
+ */
+
+class BookCheck : public BookReplay {
+public:
+  BookCheck() : BookReplay({'A', 'F', 'E', 'C', 'X', 'D', 'U'},
+    {ITCH::POS::A, ITCH::POS::F, ITCH::POS::E, ITCH::POS::C,
+     ITCH::POS::X, ITCH::POS::D, ITCH::POS::U}) {}
+  // Functions
+  void reserve(unsigned long long) {}
+  Rcpp::List getResult();
+
+private:
+  // an order of the naive book, seq gives the time priority within a level
+  struct NaiveOrder {
+    unsigned int       locateCode;
+    bool               buy;
+    unsigned int       price;
+    unsigned long long shares;
+    unsigned long long seq;
+  };
+  typedef std::map<unsigned int, unsigned long long> Levels; // the shares by price
+
+  void onApply(unsigned char* buf);
+  void add(unsigned long long orderRef, NaiveOrder order);
+  void reduce(unsigned long long orderRef, unsigned long long shares);
+  Levels& getLevels(unsigned int locateCode, bool buy) { return levels[2ULL * locateCode + buy]; }
+  TopOfBook naiveTop(unsigned int locateCode);
+
+  std::map<unsigned long long, NaiveOrder> orders; // by order reference
+  std::map<unsigned long long, Levels> levels;     // by stock locate and side
+  unsigned long long seq = 0;
+  unsigned long long applied = 0;
+  unsigned long long mismatches = 0;
+  long long firstMismatch = -1; // the index of the first message with a different top of book
+};
+
+/**
+ * @brief      Applies a message to both books and compares their top of book
+ *
+ * @param      buf   The buffer
+ */
+void BookCheck::onApply(unsigned char* buf) {
+  const unsigned long long orderRef = get8bytes(&buf[11]);
+  // the stock of a modification is taken from its order (the locate code of the message may be 0)
+  auto it = orders.find(orderRef);
+  unsigned int locate = buf[0] == 'A' || buf[0] == 'F' || it == orders.end() ?
+    get2bytes(&buf[1]) : it->second.locateCode;
+
+  book.update(buf);
+  switch (buf[0]) {
+  case 'A':
+  case 'F':
+    add(orderRef, NaiveOrder{locate, buf[19] == 'B', get4bytes(&buf[32]), get4bytes(&buf[20]), 0});
+    break;
+  case 'E':
+  case 'C':
+  case 'X':
+    reduce(orderRef, get4bytes(&buf[19]));
+    break;
+  case 'D':
+    reduce(orderRef, std::numeric_limits<unsigned long long>::max());
+    break;
+  case 'U':
+    if (it != orders.end()) {
+      NaiveOrder order = it->second;
+      reduce(orderRef, std::numeric_limits<unsigned long long>::max());
+      order.shares = get4bytes(&buf[27]);
+      order.price  = get4bytes(&buf[31]);
+      add(get8bytes(&buf[19]), order);
+    }
+    break;
+  }
+
+  const TopOfBook a = book.top(locate);
+  const TopOfBook b = naiveTop(locate);
+  if (a.bidPrice != b.bidPrice || a.bidShares != b.bidShares ||
+      a.askPrice != b.askPrice || a.askShares != b.askShares) {
+    if (firstMismatch < 0) firstMismatch = applied;
+    ++mismatches;
+  }
+  ++applied;
+}
+
+/**
+ * @brief      Adds an order to the naive book, a reused order reference replaces the old order
+ *
+ * @param[in]  orderRef  The order reference number
+ * @param[in]  order     The order
+ */
+void BookCheck::add(unsigned long long orderRef, NaiveOrder order) {
+  reduce(orderRef, std::numeric_limits<unsigned long long>::max());
+  order.seq = seq++;
+  orders[orderRef] = order;
+  getLevels(order.locateCode, order.buy)[order.price] += order.shares;
+}
+
+/**
+ * @brief      Removes shares from an order of the naive book, the order is removed
+ *              once no shares are left
+ *
+ * @param[in]  orderRef  The order reference number
+ * @param[in]  shares    The number of shares
+ */
+void BookCheck::reduce(unsigned long long orderRef, unsigned long long shares) {
+  auto it = orders.find(orderRef);
+  if (it == orders.end()) return;
+
+  NaiveOrder& order = it->second;
+  Levels& side = getLevels(order.locateCode, order.buy);
+  shares = std::min(shares, order.shares);
+  side[order.price] -= shares;
+  if (side[order.price] == 0) side.erase(order.price);
+  order.shares -= shares;
+  if (order.shares == 0) orders.erase(it);
+}
+
+/**
+ * @brief      Returns the top of book of the naive book
+ *
+ * @param[in]  locateCode  The stock locate code
+ *
+ * @return     The top of book, the price of an empty side is 0
+ */
+TopOfBook BookCheck::naiveTop(unsigned int locateCode) {
+  TopOfBook res;
+  Levels& bids = getLevels(locateCode, true);
+  Levels& asks = getLevels(locateCode, false);
+  if (!bids.empty()) {
+    res.bidPrice  = bids.rbegin()->first;
+    res.bidShares = bids.rbegin()->second;
+  }
+  if (!asks.empty()) {
+    res.askPrice  = asks.begin()->first;
+    res.askShares = asks.begin()->second;
+  }
+  return res;
+}
+
+/**
+ * @brief      Returns the result of the check
+ *
+ * @return     A list with the number of applied messages, the number of messages after which
+ *              the top of book differs, the index of the first such message (-1 if none),
+ *              the number of orders of both books, and the resting orders of the naive book
+ *              (by stock, side, and price, the orders of a level in the order of their queue)
+ */
+Rcpp::List BookCheck::getResult() {
+  std::vector<std::pair<unsigned long long, NaiveOrder>> sorted(orders.begin(), orders.end());
+  std::sort(sorted.begin(), sorted.end(), [](std::pair<unsigned long long, NaiveOrder> const& a,
+                                             std::pair<unsigned long long, NaiveOrder> const& b) {
+    if (a.second.locateCode != b.second.locateCode) return a.second.locateCode < b.second.locateCode;
+    if (a.second.buy != b.second.buy) return a.second.buy < b.second.buy;
+    if (a.second.price != b.second.price) return a.second.price < b.second.price;
+    return a.second.seq < b.second.seq;
+  });
+
+  Column<unsigned long long> orderRef, locateCode, shares, priority;
+  Column<bool>               buy;
+  Column<double>             price;
+  unsigned long long rank = 0;
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    NaiveOrder const& order = sorted[i].second;
+    const bool sameLevel = i > 0 && sorted[i - 1].second.locateCode == order.locateCode &&
+      sorted[i - 1].second.buy == order.buy && sorted[i - 1].second.price == order.price;
+    rank = sameLevel ? rank + 1 : 1;
+
+    orderRef.push_back(   sorted[i].first );
+    locateCode.push_back( order.locateCode );
+    buy.push_back(        order.buy );
+    shares.push_back(     order.shares );
+    price.push_back(      (double) order.price / 10000.0 );
+    priority.push_back(   rank );
+  }
+
+  DataFrameBuilder df(orderRef.size());
+  df.addNumeric("order_ref",   orderRef);
+  df.addNumeric("locate_code", locateCode);
+  df.addLogical("buy",         buy);
+  df.addNumeric("shares",      shares);
+  df.addNumeric("price",       price);
+  df.addNumeric("priority",    priority);
+
+  return Rcpp::List::create(
+    Rcpp::Named("messages")       = (double) applied,
+    Rcpp::Named("mismatches")     = (double) mismatches,
+    Rcpp::Named("first_mismatch") = (double) firstMismatch,
+    Rcpp::Named("book_orders")    = (double) book.size(),
+    Rcpp::Named("naive_orders")   = (double) orders.size(),
+    Rcpp::Named("orders")         = df.build()
+  );
+}
+
+// @brief      Replays the orders of a file into the OrderBook and a naive book and compares
+//              their top of book after each message (see BookCheck), used by the tests
+//
+// @param[in]  filename  The filename to a plain-text-file
+//
+// @return     The result of the check (see BookCheck::getResult)
+//
+// [[Rcpp::export]]
+Rcpp::List checkOrderBook_impl(std::string filename) {
+  BookCheck check;
+  check.replayFile(filename, 0, true, MessageFilter());
+  return check.getResult();
+}
@@ -0,0 +1,86 @@
+#include "BookReplay.h"
+#include <limits>
+#include "BookSnapshot.h"
+#include "RITCH.h"
+
+/**
+ * @brief      Adds a modification to the batch, other messages are applied after
+ *              the pending modifications
+ *
+ * @param      buf   The buffer
+ *
+ * @return     false if the boundaries are broken (all necessary messages are already loaded),
+ *              thus the loading process can be aborted, otherwise true
+ */
+bool BookReplay::loadMessages(unsigned char* buf) {
+
+  // first check if this is the wrong message
+  bool rightMessage = false;
+  for (unsigned char type : validTypes) {
+    rightMessage = rightMessage || buf[0] == type;
+  }
+
+  // if the message is of the wrong type, terminate here, but continue with the next message
+  if (!rightMessage) return true;
+
+  // if the message is out of bounds (i.e., we dont want to collect it yet!)
+  if (messageCount < startMsgCount) {
+    ++messageCount;
+    return true;
+  }
+
+  // if the message is out of bounds (i.e., we dont want to collect it ever,
+  // thus aborting the information gathering (return false!))
+  if (messageCount > endMsgCount) return false;
+  ++messageCount;
+
+  onMessage(buf);
+
+  if (ModificationBatch::isModification(buf[0])) {
+    if (batch.add(book, buf)) flush();
+    return true;
+  }
+
+  flush();
+  // the stock follows the order reference and the side in 'A', 'F', and 'P' messages
+  if (buf[0] == 'A' || buf[0] == 'F' || buf[0] == 'P') {
+    const unsigned int locate = get2bytes(&buf[1]);
+    if (locate >= stocks.size()) stocks.resize(locate + 1, 0);
+    stocks[locate] = get8bytes(&buf[24]);
+  }
+  onApply(buf);
+  return true;
+}
+
+/**
+ * @brief      Applies the batched modifications in order
+ */
+void BookReplay::flush() {
+  if (batch.empty()) return;
+  batch.apply(book, [this](unsigned char* buf) { onApply(buf); });
+}
+
+/**
+ * @brief      Fills the book and the stocks with a snapshot (see BookSnapshots),
+ *              thus the replay continues from the snapshot
+ *
+ * @param[in]  snapshot  The snapshot
+ */
+void BookReplay::seed(BookSnapshot const& snapshot) {
+  snapshot.fill(book, stocks);
+}
+
+/**
+ * @brief      Replays all messages of a file, the book is replayed in a single pass,
+ *              thus the messages are not counted first
+ *
+ * @param[in]  filename    The filename to a plain-text-file, "-" for stdin, or "| cmd"
+ * @param[in]  bufferSize  The buffer size in bytes, 0 chooses the size automatically
+ * @param[in]  quiet       If true, no status message is printed
+ * @param[in]  filter      The filter of the messages (see MessageFilter)
+ */
+void BookReplay::replayFile(std::string const& filename, unsigned long long bufferSize, bool quiet,
+                            MessageFilter const& filter) {
+  if (!quiet) Rcpp::Rcout << "[Loading]    ";
+  loadToMessages(filename, *this, 0, std::numeric_limits<unsigned long long>::max(), bufferSize, quiet, filter);
+}
@@ -0,0 +1,56 @@
+#ifndef BOOKREPLAY_H
+#define BOOKREPLAY_H
+
+#include <Rcpp.h>
+#include <string>
+#include <vector>
+#include "MessageFilter.h"
+#include "MessageTypes.h"
+#include "OrderBook.h"
+#include "Specifications.h"
+// [[Rcpp::plugins("cpp11")]]
+
+struct BookSnapshot;
+
+/**
+ * #################################################################
+ * BookReplay is the base of the message types that replay the order book
+ *  (see OrderBook), i.e., TradeQuotes, MidPrices, MarketActivity, and BookSnapshots.
+ *
+ * Consecutive modifications ('E', 'C', 'X', 'D', and 'U') are collected in a
+ *  batch (see ModificationBatch), which is applied once it is full or before the
+ *  next other message, thus the lookups of their orders are prefetched together.
+ *  Every message is passed to onApply in the order of the file, which applies it
+ *  to the book, thus a subclass sees the book as of each message.
+ *
+ * The raw stock of each locate code is taken from the additions ('A', 'F')
+ *  and the non-displayed trades ('P').
+ * #################################################################
+ */
+
+class BookReplay : public MessageType {
+public:
+  // Functions
+  bool loadMessages(unsigned char* buf);
+  void finish() { flush(); }
+  void seed(BookSnapshot const& snapshot);
+  void replayFile(std::string const& filename, unsigned long long bufferSize, bool quiet,
+                  MessageFilter const& filter);
+
+protected:
+  BookReplay(std::vector<unsigned char> const& validTypes,
+             std::vector<int> const& typePositions) : MessageType(validTypes, typePositions) {}
+
+  // called for each loaded message before it is batched (i.e., to write snapshots by time)
+  virtual void onMessage(unsigned char*) {}
+  // called for each message in the order of the file, has to apply it to the book
+  virtual void onApply(unsigned char* buf) = 0;
+  void flush();
+
+  // Members
+  OrderBook book;
+  ModificationBatch batch; // the pending modifications ('E', 'C', 'X', 'D', and 'U')
+  std::vector<unsigned long long> stocks; // the raw stock by locate code
+};
+
+#endif //BOOKREPLAY_H
@@ -0,0 +1,362 @@
+#include "BookSnapshot.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "DataFrameBuilder.h"
+#include "RITCH.h"
+#include "Session.h"
+
+// the sizes of the records of a snapshot in bytes
+const size_t SNAPSHOT_HEADER_SIZE = 14;
+const size_t SNAPSHOT_STOCK_SIZE  = 10;
+const size_t SNAPSHOT_ORDER_SIZE  = 19;
+
+/**
+ * @brief      Appends a big-endian number to a buffer
+ *
+ * @param      buf    The buffer
+ * @param[in]  x      The number
+ * @param[in]  bytes  The number of bytes
+ */
+static void appendBytes(std::vector<unsigned char>& buf, unsigned long long x, int bytes) {
+  for (int i = bytes - 1; i >= 0; --i) buf.push_back((x >> (8 * i)) & 0xFF);
+}
+
+/**
+ * @brief      Opens a book file, the magic bytes are written or checked
+ *
+ * @param[in]  filename  The filename
+ * @param[in]  write     If true, the file is created (or truncated), otherwise it is read
+ *
+ * @return     The file
+ */
+FILE* openBookFile(std::string const& filename, bool write) {
+  FILE* file = fopen(filename.c_str(), write ? "wb" : "rb");
+  if (file == NULL) Rcpp::stop("Could not open the book file %s", filename);
+
+  const size_t len = strlen(BOOK_FILE_MAGIC);
+  if (write) {
+    fwrite(BOOK_FILE_MAGIC, 1, len, file);
+  } else {
+    char magic[sizeof(BOOK_FILE_MAGIC)] = {0};
+    if (fread(magic, 1, len, file) != len || memcmp(magic, BOOK_FILE_MAGIC, len) != 0) {
+      fclose(file);
+      Rcpp::stop("%s is not a book file", filename);
+    }
+  }
+  return file;
+}
+
+/**
+ * @brief      Reads the next snapshot of a book file
+ *
+ * @param      file  The file, after the magic bytes or the previous snapshot
+ *
+ * @return     false if the end of the file is reached
+ */
+bool BookSnapshot::read(FILE* file) {
+  std::vector<unsigned char> buf(SNAPSHOT_HEADER_SIZE);
+  const size_t n = fread(buf.data(), 1, SNAPSHOT_HEADER_SIZE, file);
+  if (n == 0) return false;
+  if (n != SNAPSHOT_HEADER_SIZE) Rcpp::stop("The book file is truncated");
+
+  timestamp = get6bytes(&buf[0]);
+  const unsigned int nStocks = get4bytes(&buf[6]);
+  const unsigned int nOrders = get4bytes(&buf[10]);
+
+  const size_t size = nStocks * SNAPSHOT_STOCK_SIZE + (size_t) nOrders * SNAPSHOT_ORDER_SIZE;
+  buf.resize(size);
+  if (size > 0 && fread(buf.data(), 1, size, file) != size) Rcpp::stop("The book file is truncated");
+
+  stocks.clear();
+  unsigned char* p = buf.data();
+  for (unsigned int i = 0; i < nStocks; ++i, p += SNAPSHOT_STOCK_SIZE) {
+    const unsigned int locate = get2bytes(p);
+    if (locate >= stocks.size()) stocks.resize(locate + 1, 0);
+    stocks[locate] = get8bytes(p + 2);
+  }
+
+  orders.resize(nOrders);
+  for (SnapshotOrder& order : orders) {
+    order.orderRef   = get8bytes(p);
+    order.locateCode = get2bytes(p + 8);
+    order.buy        = p[10] == 'B';
+    order.shares     = get4bytes(p + 11);
+    order.price      = get4bytes(p + 15);
+    p += SNAPSHOT_ORDER_SIZE;
+  }
+  return true;
+}
+
+/**
+ * @brief      Adds the orders of the snapshot to a book, in the order of the file
+ *              (thus the orders keep their time priority)
+ *
+ * @param      book        The book
+ * @param      bookStocks  The raw stock by locate code, the stocks of the snapshot are added
+ */
+void BookSnapshot::fill(OrderBook& book, std::vector<unsigned long long>& bookStocks) const {
+  for (SnapshotOrder const& order : orders) {
+    book.add(order.orderRef, order.locateCode, order.buy, order.price, order.shares);
+  }
+  if (stocks.size() > bookStocks.size()) bookStocks.resize(stocks.size(), 0);
+  for (size_t i = 0; i < stocks.size(); ++i) {
+    if (stocks[i] != 0) bookStocks[i] = stocks[i];
+  }
+}
+
+/**
+ * @brief      Reads the last snapshot (the end of the replayed messages) of a book file
+ *
+ * @param[in]  filename  The filename
+ *
+ * @return     The snapshot
+ */
+BookSnapshot readLastSnapshot(std::string const& filename) {
+  BookFile file(openBookFile(filename, false), fclose);
+  BookSnapshot snapshot, next;
+  bool found = false;
+  while (next.read(file.get())) {
+    std::swap(snapshot, next);
+    found = true;
+  }
+  file.reset();
+  if (!found) Rcpp::stop("The book file %s contains no snapshot", filename);
+  return snapshot;
+}
+
+// ################################################################################
+// ############################### BOOK SNAPSHOTS #################################
+// ################################################################################
+
+/**
+ * @brief      Creates the book file
+ *
+ * @param[in]  filename  The filename of the book file
+ * @param[in]  times     The timestamps of the snapshots in nanoseconds since midnight,
+ *                        the end of the replayed messages is always written
+ */
+BookSnapshots::BookSnapshots(std::string const& filename, std::vector<unsigned long long> times) :
+  BookReplay({'A', 'F', 'E', 'C', 'X', 'D', 'U'},
+             {ITCH::POS::A, ITCH::POS::F, ITCH::POS::E, ITCH::POS::C,
+              ITCH::POS::X, ITCH::POS::D, ITCH::POS::U}),
+  times(times) {
+  std::sort(this->times.begin(), this->times.end());
+  file = openBookFile(filename, true);
+}
+
+BookSnapshots::~BookSnapshots() {
+  if (file != NULL) fclose(file);
+}
+
+/**
+ * @brief      Writes the snapshots of the timestamps before the message, thus they
+ *              contain the book up to and including the timestamps
+ *
+ * @param      buf   The buffer
+ */
+void BookSnapshots::onMessage(unsigned char* buf) {
+  lastTimestamp = get6bytes(&buf[5]);
+  while (nextTime < times.size() && times[nextTime] < lastTimestamp) {
+    flush();
+    write(times[nextTime++]);
+  }
+}
+
+/**
+ * @brief      Writes the remaining snapshots and the final book, and closes the file
+ */
+void BookSnapshots::finish() {
+  if (file == NULL) return;
+  flush();
+  while (nextTime < times.size()) write(times[nextTime++]);
+  // a snapshot after the last message equals the final book
+  if (snapshotTime.empty() || snapshotTime.back() < lastTimestamp) write(lastTimestamp);
+
+  fclose(file);
+  file = NULL;
+}
+
+/**
+ * @brief      Writes a snapshot of the current book
+ *
+ * @param[in]  time  The timestamp of the snapshot
+ */
+void BookSnapshots::write(unsigned long long time) {
+  std::vector<unsigned char> orders;
+  orders.reserve(book.size() * SNAPSHOT_ORDER_SIZE);
+  std::vector<bool> used(stocks.size(), false);
+
+  book.forEachOrder([&](unsigned long long orderRef, BookOrder const& order) {
+    appendBytes(orders, orderRef, 8);
+    appendBytes(orders, order.locateCode, 2);
+    orders.push_back(order.buy ? 'B' : 'S');
+    appendBytes(orders, order.shares, 4);
+    appendBytes(orders, order.price, 4);
+    if (order.locateCode < used.size()) used[order.locateCode] = true;
+  });
+
+  // only the stocks with resting orders are written
+  std::vector<unsigned char> head;
+  unsigned int nStocks = 0;
+  for (size_t i = 0; i < used.size(); ++i) {
+    if (!used[i]) continue;
+    appendBytes(head, i, 2);
+    appendBytes(head, stocks[i], 8);
+    ++nStocks;
+  }
+
+  std::vector<unsigned char> header;
+  appendBytes(header, time, 6);
+  appendBytes(header, nStocks, 4);
+  appendBytes(header, orders.size() / SNAPSHOT_ORDER_SIZE, 4);
+
+  if (fwrite(header.data(), 1, header.size(), file) != header.size() ||
+      fwrite(head.data(), 1, head.size(), file) != head.size() ||
+      fwrite(orders.data(), 1, orders.size(), file) != orders.size()) {
+    Rcpp::stop("Could not write the book file");
+  }
+
+  snapshotTime.push_back(time);
+  stockCount.push_back(nStocks);
+  orderCount.push_back(orders.size() / SNAPSHOT_ORDER_SIZE);
+}
+
+/**
+ * @brief      Converts the written snapshots into an Rcpp::DataFrame
+ *
+ * @return     The Rcpp::DataFrame
+ */
+Rcpp::DataFrame BookSnapshots::getDF() {
+  DataFrameBuilder df(snapshotTime.size());
+  df.addNumeric("timestamp", snapshotTime);
+  df.addNumeric("stocks",    stockCount);
+  df.addNumeric("orders",    orderCount);
+  return df.build();
+}
+
+
+/**
+ * @brief      Converts the requested timestamps of R (nanoseconds since midnight)
+ *
+ * @param[in]  times  The timestamps
+ *
+ * @return     The timestamps as integers
+ */
+static std::vector<unsigned long long> toTimestamps(Rcpp::NumericVector times) {
+  std::vector<unsigned long long> res;
+  for (double t : times) {
+    if (std::isnan(t) || t < 0) Rcpp::stop("times have to be non-negative nanoseconds since midnight");
+    res.push_back((unsigned long long) t);
+  }
+  return res;
+}
+
+// @brief      Replays the book of a file and writes the snapshots to a book file
+//
+// @param[in]  filename     The filename to a plain-text-file, "-" for stdin, or "| cmd"
+// @param[in]  bookFile     The filename of the book file
+// @param[in]  times        The timestamps of the snapshots in nanoseconds since midnight
+// @param[in]  bufferSize   The buffer size in bytes, 0 chooses the size automatically
+// @param[in]  stockLocate  The stock locate codes to load, empty for all stocks
+// @param[in]  quiet        If true, no status message is printed
+//
+// @return     The written snapshots in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame writeBook_impl(std::string filename,
+                               std::string bookFile,
+                               Rcpp::NumericVector times,
+                               unsigned long long bufferSize,
+                               Rcpp::IntegerVector stockLocate,
+                               bool quiet) {
+  BookSnapshots snapshots(bookFile, toTimestamps(times));
+
+  snapshots.replayFile(filename, bufferSize, quiet, MessageFilter::create(stockLocate, MARKET_ALL, TRADING_KEEP));
+
+  if (!quiet) Rcpp::Rcout << "\n[Converting] to data.table\n";
+  return snapshots.getDF();
+}
+
+// @brief      Replays the book of a session and writes the snapshots to a book file
+//
+// @param[in]  session      The external pointer to the session
+// @param[in]  bookFile     The filename of the book file
+// @param[in]  times        The timestamps of the snapshots in nanoseconds since midnight
+// @param[in]  stockLocate  The stock locate codes to load, empty for all stocks
+// @param[in]  quiet        If true, no status message is printed
+//
+// @return     The written snapshots in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame writeSessionBook_impl(SEXP session,
+                                      std::string bookFile,
+                                      Rcpp::NumericVector times,
+                                      Rcpp::IntegerVector stockLocate,
+                                      bool quiet) {
+  BookSnapshots snapshots(bookFile, toTimestamps(times));
+  return getSessionMessagesTemplate(snapshots, session, 0, 0, stockLocate, MARKET_ALL, TRADING_KEEP, quiet);
+}
+
+// @brief      Reads the orders of the snapshots of a book file
+//
+// @param[in]  bookFile     The filename of the book file
+// @param[in]  times        The timestamps of the snapshots to read, empty for all snapshots
+// @param[in]  stockLocate  The stock locate codes to read, empty for all stocks
+//
+// @return     The orders in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame readBook_impl(std::string bookFile,
+                              Rcpp::NumericVector times,
+                              Rcpp::IntegerVector stockLocate) {
+  const std::vector<unsigned long long> selected = toTimestamps(times);
+  std::vector<bool> stockSelected(stockLocate.size() == 0 ? 0 : 65536, false);
+  for (int locate : stockLocate) {
+    if (locate < 0 || locate > 65535) Rcpp::stop("stock_locate has to be between 0 and 65535");
+    stockSelected[locate] = true;
+  }
+
+  Column<unsigned long long> timestamp, orderRef, locateCode, stock, shares, priority;
+  Column<bool>               buy;
+  Column<double>             price;
+
+  BookFile file(openBookFile(bookFile, false), fclose);
+  BookSnapshot snapshot;
+  while (snapshot.read(file.get())) {
+    if (!selected.empty() &&
+        std::find(selected.begin(), selected.end(), snapshot.timestamp) == selected.end()) continue;
+
+    // the orders of a level are consecutive, in the order of their queue
+    unsigned long long rank = 0;
+    const SnapshotOrder* prev = NULL;
+    for (SnapshotOrder const& order : snapshot.orders) {
+      const bool sameLevel = prev != NULL && prev->locateCode == order.locateCode &&
+        prev->buy == order.buy && prev->price == order.price;
+      rank = sameLevel ? rank + 1 : 1;
+      prev = &order;
+      if (!stockSelected.empty() && !stockSelected[order.locateCode]) continue;
+
+      timestamp.push_back(  snapshot.timestamp );
+      orderRef.push_back(   order.orderRef );
+      locateCode.push_back( order.locateCode );
+      stock.push_back(      order.locateCode < snapshot.stocks.size() ? snapshot.stocks[order.locateCode] : 0ULL );
+      buy.push_back(        order.buy );
+      shares.push_back(     order.shares );
+      price.push_back(      (double) order.price / 10000.0 );
+      priority.push_back(   rank );
+    }
+  }
+  file.reset();
+
+  DataFrameBuilder df(timestamp.size());
+  df.addNumeric("timestamp",   timestamp);
+  df.addNumeric("order_ref",   orderRef);
+  df.addNumeric("locate_code", locateCode);
+  df.addSymbol( "stock",       stock);
+  df.addLogical("buy",         buy);
+  df.addNumeric("shares",      shares);
+  df.addNumeric("price",       price);
+  df.addNumeric("priority",    priority);
+  return df.build();
+}
@@ -0,0 +1,91 @@
+#ifndef BOOKSNAPSHOT_H
+#define BOOKSNAPSHOT_H
+
+#include <Rcpp.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include "BookReplay.h"
+#include "MessageTypes.h"
+#include "OrderBook.h"
+#include "Specifications.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * BookSnapshots replays the order book (see BookReplay) and writes the resting
+ *  orders at chosen timestamps and at the end of the replayed messages into
+ *  a binary file, thus later jobs load the books without replaying the day.
+ *
+ * A snapshot at a timestamp contains all messages up to and including
+ *  the timestamp. The file is big-endian (as ITCH) and consists of
+ *
+ *   header:   "RITCHBK1"
+ *   snapshot: timestamp (6 bytes), number of stocks (4), number of orders (4),
+ *             the stocks: stock locate (2), stock (8),
+ *             the orders: order reference (8), stock locate (2), side ('B' or 'S', 1),
+ *                         shares (4), price (4)
+ *
+ *  the orders of a price level are written in the order of their queue,
+ *  thus a book that is filled in file order keeps the time priority.
+ * #################################################################
+ */
+
+// the first bytes of a book file
+const char BOOK_FILE_MAGIC[] = "RITCHBK1";
+
+// an order of a snapshot
+struct SnapshotOrder {
+  unsigned long long orderRef;
+  unsigned int       locateCode;
+  bool               buy;
+  unsigned long long shares;
+  unsigned int       price;
+};
+
+// the resting orders of all stocks at a timestamp
+struct BookSnapshot {
+  unsigned long long              timestamp = 0;
+  std::vector<unsigned long long> stocks; // the raw stock by locate code, 0 if unknown
+  std::vector<SnapshotOrder>      orders;
+
+  bool read(FILE* file);
+  void fill(OrderBook& book, std::vector<unsigned long long>& bookStocks) const;
+};
+
+// a book file that is closed when it goes out of scope (also if reading it fails)
+typedef std::unique_ptr<FILE, int (*)(FILE*)> BookFile;
+
+FILE* openBookFile(std::string const& filename, bool write);
+BookSnapshot readLastSnapshot(std::string const& filename);
+
+class BookSnapshots : public BookReplay {
+public:
+  BookSnapshots(std::string const& filename, std::vector<unsigned long long> times);
+  ~BookSnapshots();
+  BookSnapshots(BookSnapshots const&) = delete;
+  void operator=(BookSnapshots const&) = delete;
+
+  // Functions
+  void reserve(unsigned long long) {} // one row per snapshot
+  void finish();
+  Rcpp::DataFrame getDF();
+
+  // Members
+  Column<unsigned long long> snapshotTime;
+  Column<unsigned long long> stockCount;
+  Column<unsigned long long> orderCount;
+
+private:
+  void onMessage(unsigned char* buf);
+  void onApply(unsigned char* buf) { book.update(buf); }
+  void write(unsigned long long time);
+
+  std::vector<unsigned long long> times;  // the requested timestamps, sorted
+  size_t nextTime = 0;
+  unsigned long long lastTimestamp = 0;
+  FILE* file = NULL;
+};
+
+#endif //BOOKSNAPSHOT_H
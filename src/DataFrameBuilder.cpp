@@ -0,0 +1,66 @@
+#include "DataFrameBuilder.h"
+#include <cstring>
+
+/**
+ * @brief      Converts the unsigned integers (i.e., timestamps or shares) into doubles,
+ *              the loop is vectorized
+ *
+ * @param[in]  src   The values
+ * @param      dst   The doubles
+ * @param[in]  n     The number of values
+ */
+void copyToDouble(const unsigned long long* src, double* dst, unsigned long long n) {
+  for (unsigned long long i = 0; i < n; ++i) dst[i] = (double) src[i];
+}
+
+/**
+ * @brief      Copies the doubles (i.e., prices)
+ *
+ * @param[in]  src   The values
+ * @param      dst   The doubles
+ * @param[in]  n     The number of values
+ */
+void copyToDouble(const double* src, double* dst, unsigned long long n) {
+  if (n > 0) memcpy(dst, src, n * sizeof(double));
+}
+
+/**
+ * @brief      Adds a column that was already created on the main thread (i.e., strings)
+ *
+ * @param[in]  name  The name of the column
+ * @param[in]  x     The R vector
+ */
+void DataFrameBuilder::add(const std::string& name, SEXP x) {
+  names.push_back(name);
+  columns.push_back(Rcpp::RObject(x));
+}
+
+/**
+ * @brief      Fills the numeric and logical columns in parallel and 
+ *              assembles the columns into an Rcpp::DataFrame
+ *
+ * @return     The Rcpp::DataFrame
+ */
+Rcpp::DataFrame DataFrameBuilder::build() {
+  // each thread fills a contiguous block of rows of all columns
+  ThreadPool::instance().parallelFor(nrow, GRAIN, 
+    [this](unsigned long long begin, unsigned long long end) {
+      for (auto& fill : fills) fill(begin, end);
+    });
+  fills.clear();
+
+  Rcpp::List df(columns.size());
+  for (unsigned long long i = 0; i < columns.size(); ++i) {
+    SET_VECTOR_ELT(df, i, columns[i]);
+  }
+  df.attr("names")     = Rcpp::wrap(names);
+  df.attr("class")     = "data.frame";
+  // compact form of the row names, as used by R
+  if (nrow == 0) {
+    df.attr("row.names") = Rcpp::IntegerVector(0);
+  } else {
+    df.attr("row.names") = Rcpp::IntegerVector::create(NA_INTEGER, -((int) nrow));
+  }
+  
+  return Rcpp::DataFrame(df);
+}
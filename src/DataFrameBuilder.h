@@ -0,0 +1,198 @@
+#ifndef DATAFRAMEBUILDER_H
+#define DATAFRAMEBUILDER_H
+
+#include <Rcpp.h>
+#include <array>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include "ThreadPool.h"
+#include "MessageTypes.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * DataFrameBuilder converts the content vectors of a MessageType
+ *  into an Rcpp::DataFrame.
+ *
+ * All R vectors are allocated on the main thread when a column is added,
+ *  the numeric and logical columns are then filled in parallel by the
+ *  ThreadPool in build(). Character columns are created on the main
+ *  thread, as they need the R API. Single-byte codes (i.e., the message type)
+ *  become factors of a fixed level table, which are filled in parallel as well.
+ * #################################################################
+ */
+
+void copyToDouble(const unsigned long long* src, double* dst, unsigned long long n);
+void copyToDouble(const double* src, double* dst, unsigned long long n);
+
+/**
+ * @brief      Converts a numeric content vector into doubles
+ *
+ * @param[in]  src   The values
+ * @param      dst   The doubles
+ * @param[in]  n     The number of values
+ */
+template <typename T>
+void copyToDouble(const T* src, double* dst, unsigned long long n) {
+  for (unsigned long long i = 0; i < n; ++i) dst[i] = (double) src[i];
+}
+
+class DataFrameBuilder {
+public:
+  explicit DataFrameBuilder(unsigned long long nrow) : nrow(nrow) {}
+
+  // Functions
+  template <typename T, typename A>
+  void addNumeric(const std::string& name, const std::vector<T, A>& x);
+  template <typename A>
+  void addLogical(const std::string& name, const std::vector<bool, A>& x);
+  template <typename A>
+  void addChar(const std::string& name, const std::vector<char, A>& x);
+  template <typename A>
+  void addFactor(const std::string& name, const std::vector<char, A>& x,
+                 const std::vector<unsigned char>& levels);
+  template <typename T, typename A>
+  void addSymbol(const std::string& name, const std::vector<T, A>& x);
+  void add(const std::string& name, SEXP x);
+  Rcpp::DataFrame build();
+
+private:
+  // the number of rows per chunk that is filled by one thread
+  static const unsigned long long GRAIN = 1ULL << 16;
+
+  unsigned long long nrow;
+  std::vector<std::string> names;
+  std::vector<Rcpp::RObject> columns;
+  std::vector<std::function<void(unsigned long long, unsigned long long)>> fills;
+};
+
+/**
+ * @brief      Adds a numeric column, the values are copied in build()
+ *
+ * @param[in]  name  The name of the column
+ * @param[in]  x     The content vector, has to outlive the call to build()
+ */
+template <typename T, typename A>
+void DataFrameBuilder::addNumeric(const std::string& name, const std::vector<T, A>& x) {
+  Rcpp::NumericVector col(Rcpp::no_init(x.size()));
+  double* dst  = REAL(col);
+  const T* src = x.data();
+  fills.push_back([dst, src](unsigned long long begin, unsigned long long end) {
+    copyToDouble(src + begin, dst + begin, end - begin);
+  });
+  names.push_back(name);
+  columns.push_back(col);
+}
+
+/**
+ * @brief      Adds a logical column, the values are copied in build()
+ *
+ * @param[in]  name  The name of the column
+ * @param[in]  x     The content vector, has to outlive the call to build()
+ */
+template <typename A>
+void DataFrameBuilder::addLogical(const std::string& name, const std::vector<bool, A>& x) {
+  Rcpp::LogicalVector col(Rcpp::no_init(x.size()));
+  int* dst = LOGICAL(col);
+  const std::vector<bool, A>* src = &x;
+  fills.push_back([dst, src](unsigned long long begin, unsigned long long end) {
+    for (unsigned long long i = begin; i < end; ++i) dst[i] = (*src)[i];
+  });
+  names.push_back(name);
+  columns.push_back(col);
+}
+
+/**
+ * @brief      Adds a character column of single characters,
+ *              the column is created directly on the main thread
+ *
+ * @param[in]  name  The name of the column
+ * @param[in]  x     The content vector
+ */
+template <typename A>
+void DataFrameBuilder::addChar(const std::string& name, const std::vector<char, A>& x) {
+  Rcpp::CharacterVector col(x.size());
+  // only 256 possible values, create each CHARSXP only once
+  SEXP cache[256] = {NULL};
+  for (unsigned long long i = 0; i < x.size(); ++i) {
+    const unsigned char c = x[i];
+    if (cache[c] == NULL) {
+      const char str = c;
+      cache[c] = c == 0 ? Rf_mkChar("") : Rf_mkCharLen(&str, 1);
+    }
+    SET_STRING_ELT(col, i, cache[c]);
+  }
+  names.push_back(name);
+  columns.push_back(col);
+}
+
+/**
+ * @brief      Adds a factor column of single-byte codes, the codes are copied in build()
+ *
+ * @param[in]  name    The name of the column
+ * @param[in]  x       The content vector, has to outlive the call to build()
+ * @param[in]  levels  The levels of the factor, codes that are not a level are NA
+ */
+template <typename A>
+void DataFrameBuilder::addFactor(const std::string& name, const std::vector<char, A>& x,
+                                 const std::vector<unsigned char>& levels) {
+  Rcpp::IntegerVector col(Rcpp::no_init(x.size()));
+  Rcpp::CharacterVector levelNames(levels.size());
+  std::array<int, 256> codes;
+  codes.fill(NA_INTEGER);
+  for (unsigned long long i = 0; i < levels.size(); ++i) {
+    const char str = levels[i];
+    codes[levels[i]] = i + 1;
+    SET_STRING_ELT(levelNames, i, Rf_mkCharLen(&str, 1));
+  }
+  col.attr("levels") = levelNames;
+  col.attr("class")  = "factor";
+
+  int* dst        = INTEGER(col);
+  const char* src = x.data();
+  fills.push_back([dst, src, codes](unsigned long long begin, unsigned long long end) {
+    for (unsigned long long i = begin; i < end; ++i) dst[i] = codes[(unsigned char) src[i]];
+  });
+  names.push_back(name);
+  columns.push_back(col);
+}
+
+/**
+ * @brief      Adds a character column from raw ITCH alpha fields (i.e., stocks or MPIDs),
+ *              the width of the field is given by the size of T (8 or 4 characters).
+ *              Each distinct field is converted to an R string only once,
+ *              the column is created directly on the main thread
+ *
+ * @param[in]  name  The name of the column
+ * @param[in]  x     The raw fields as returned by get8bytes or get4bytes
+ */
+template <typename T, typename A>
+void DataFrameBuilder::addSymbol(const std::string& name, const std::vector<T, A>& x) {
+  const unsigned int nChars = sizeof(T);
+  Rcpp::CharacterVector col(x.size());
+  
+  std::unordered_map<T, SEXP> cache;
+  T lastKey    = 0;
+  SEXP lastStr = NULL;
+  char str[8];
+  
+  for (unsigned long long i = 0; i < x.size(); ++i) {
+    if (lastStr == NULL || x[i] != lastKey) {
+      auto it = cache.find(x[i]);
+      if (it == cache.end()) {
+        const unsigned int len = getSymbolChars(x[i], nChars, str);
+        it = cache.emplace(x[i], Rf_mkCharLen(str, len)).first;
+      }
+      lastKey = x[i];
+      lastStr = it->second;
+    }
+    // the first use of each string protects it
+    SET_STRING_ELT(col, i, lastStr);
+  }
+  names.push_back(name);
+  columns.push_back(col);
+}
+
+#endif //DATAFRAMEBUILDER_H
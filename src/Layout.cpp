@@ -0,0 +1,276 @@
+#include "Layout.h"
+#include <cstring>
+#include "Memory.h"
+
+// the number of messages that are checked by detectVersion
+const int DETECT_MESSAGES = 64;
+
+/**
+ * @brief      Writes a number in big endian into a buffer
+ *
+ * @param      buf    The buffer
+ * @param[in]  x      The number
+ * @param[in]  bytes  The number of bytes
+ */
+static inline void putBytes(unsigned char* buf, unsigned long long x, int bytes) {
+  for (int i = bytes - 1; i >= 0; --i) *buf++ = (x >> (8 * i)) & 0xFF;
+}
+
+/**
+ * @brief      Returns the lengths of a given ITCH 4.1 message type
+ *
+ * @param[in]  msgType  The message type
+ * @param[in]  warn     If true, unknown message types are reported
+ *
+ * @return     The message length, 1 for unknown message types (0 if warn is false)
+ */
+unsigned long long getMessageLength41(unsigned char msgType, bool warn) {
+  switch (msgType) {
+  case 'T':
+    return ITCH41::SIZE::T;
+  case 'S':
+    return ITCH41::SIZE::S;
+  case 'R':
+    return ITCH41::SIZE::R;
+  case 'H':
+    return ITCH41::SIZE::H;
+  case 'Y':
+    return ITCH41::SIZE::Y;
+  case 'L':
+    return ITCH41::SIZE::L;
+  case 'A':
+    return ITCH41::SIZE::A;
+  case 'F':
+    return ITCH41::SIZE::F;
+  case 'E':
+    return ITCH41::SIZE::E;
+  case 'C':
+    return ITCH41::SIZE::C;
+  case 'X':
+    return ITCH41::SIZE::X;
+  case 'D':
+    return ITCH41::SIZE::D;
+  case 'U':
+    return ITCH41::SIZE::U;
+  case 'P':
+    return ITCH41::SIZE::P;
+  case 'Q':
+    return ITCH41::SIZE::Q;
+  case 'B':
+    return ITCH41::SIZE::B;
+  case 'I':
+    return ITCH41::SIZE::I;
+  case 'N':
+    return ITCH41::SIZE::N;
+  default:
+    if (!warn) return 0;
+    Rcpp::Rcout << "Unkown Message Type\n";
+  return 1;
+  }
+}
+
+/**
+ * @brief      Detects the ITCH version of a file from its first messages, the first
+ *              messages of an ITCH 4.1 file are framed by the 4.1 lengths, which have
+ *              to match the 2 byte length in front of each message
+ *
+ * @param      buf   The buffer with the start of the file
+ * @param[in]  size  The size of the buffer
+ *
+ * @return     ITCH_41 if the first messages are ITCH 4.1 messages, otherwise ITCH_50
+ */
+ITCHVersion detectVersion(unsigned char* buf, unsigned long long size) {
+  unsigned long long idx = 2;
+  int nMessages = 0;
+  while (idx < size && nMessages < DETECT_MESSAGES) {
+    const unsigned long long thisMsgLength = getMessageLength41(buf[idx], false);
+    if (thisMsgLength == 0 || get2bytes(&buf[idx - 2]) != thisMsgLength) return ITCH_50;
+    // a truncated message at the end of the buffer
+    if (idx + thisMsgLength > size) break;
+    idx += thisMsgLength + 2;
+    ++nMessages;
+  }
+  return nMessages > 0 ? ITCH_41 : ITCH_50;
+}
+
+/**
+ * @brief      Converts an ITCH 4.1 file into the ITCH 5.0 layout (see Layout41)
+ *
+ * @param      data     The file
+ * @param[in]  size     The size of the file
+ * @param      newSize  The size of the converted file
+ *
+ * @return     The converted file, allocated with allocateMemory
+ */
+unsigned char* convertToLayout50(unsigned char* data, unsigned long long size, unsigned long long& newSize) {
+  // the first pass finds the size of the converted file, unknown messages are skipped
+  newSize = 0;
+  unsigned long long idx = 2;
+  while (idx < size) {
+    const unsigned char type = data[idx];
+    const unsigned long long thisMsgLength = getMessageLength41(type, false);
+    const unsigned long long step = thisMsgLength == 0 ? 1 : thisMsgLength;
+    if (idx + step > size) break;
+    if (thisMsgLength > 0 && Layout41::isData(type)) newSize += getMessageLength(type) + 2;
+    idx += step + 2;
+  }
+
+  unsigned char* converted = static_cast<unsigned char*>(allocateMemory(newSize > 0 ? newSize : 1));
+  if (converted == NULL) Rcpp::stop("Could not allocate the memory to convert the file");
+
+  Layout41 layout;
+  unsigned long long out = 0;
+  unsigned long long nMessages = 0;
+  idx = 2;
+  while (idx < size) {
+    const unsigned long long thisMsgLength = getMessageLength41(data[idx], false);
+    const unsigned long long step = thisMsgLength == 0 ? 1 : thisMsgLength;
+    if (idx + step > size) break;
+
+    unsigned char* msg = layout.normalize(&data[idx]);
+    if (msg != NULL) {
+      const unsigned long long len = getMessageLength(msg[0]);
+      putBytes(&converted[out], len, 2);
+      memcpy(&converted[out + 2], msg, len);
+      out += len + 2;
+    }
+    idx += step + 2;
+    if ((++nMessages & 0xFFFFF) == 0) Rcpp::checkUserInterrupt();
+  }
+  return converted;
+}
+
+// ################################################################################
+// ################################## LAYOUT 4.1 ##################################
+// ################################################################################
+
+/**
+ * @brief      Rewrites an ITCH 4.1 message into the ITCH 5.0 layout, the fields after the
+ *              timestamp are copied as they are, the missing fields of the 5.0 stock directory are 0
+ *
+ * @param      buf   The buffer, starting at the message type
+ *
+ * @return     The message in the 5.0 layout (valid until the next message),
+ *              NULL for time messages ('T') and unknown messages
+ */
+unsigned char* Layout41::normalize(unsigned char* buf) {
+  const unsigned char type = buf[0];
+  if (type == 'T') {
+    seconds = get4bytes(&buf[1]);
+    return NULL;
+  }
+  const unsigned long long len41 = getMessageLength41(type, false);
+  if (len41 == 0) return NULL;
+  const unsigned long long len50 = getMessageLength(type);
+
+  // type (1), stock locate (2), tracking number (2), timestamp (6), then the fields of 4.1
+  out[0] = type;
+  putBytes(&out[3], 0, 2);
+  putBytes(&out[5], seconds * 1000000000ULL + get4bytes(&buf[1]), 6);
+  memcpy(&out[11], &buf[5], len41 - 5);
+  if (len50 > len41 + 6) memset(&out[len41 + 6], 0, len50 - len41 - 6);
+  putBytes(&out[1], getLocate(out), 2);
+  return out;
+}
+
+/**
+ * @brief      Returns the stock locate of a message and tracks the orders,
+ *              thus the modifications get the stock locate of their order. An order is 
+ *              kept until it is deleted, replaced, or has no remaining shares
+ *              (ITCH sends no delete after an order is fully executed)
+ *
+ * @param      msg   The message in the 5.0 layout (without the stock locate)
+ *
+ * @return     The stock locate, 0 for messages without a stock
+ */
+unsigned int Layout41::getLocate(unsigned char* msg) {
+  switch (msg[0]) {
+  case 'R':
+  case 'H':
+  case 'Y':
+  case 'N':
+    return stockLocate(get8bytes(&msg[11]));
+  case 'L':
+    return stockLocate(get8bytes(&msg[15]));
+  case 'Q':
+    return stockLocate(get8bytes(&msg[19]));
+  case 'I':
+    return stockLocate(get8bytes(&msg[28]));
+  case 'P':
+    return stockLocate(get8bytes(&msg[24]));
+  case 'A':
+  case 'F': {
+    const unsigned int locate = stockLocate(get8bytes(&msg[24]));
+    orders[get8bytes(&msg[11])] = {locate, get4bytes(&msg[20])};
+    return locate;
+  }
+  case 'E':
+  case 'C':
+  case 'X':
+    return reduceOrder(get8bytes(&msg[11]), get4bytes(&msg[19]));
+  case 'D':
+    return orderLocate(get8bytes(&msg[11]), true);
+  case 'U': {
+    // the new order keeps the stock
+    const unsigned int locate = orderLocate(get8bytes(&msg[11]), true);
+    if (locate != 0) orders[get8bytes(&msg[19])] = {locate, get4bytes(&msg[27])};
+    return locate;
+  }
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief      Returns the stock locate of an order
+ *
+ * @param[in]  orderRef  The order reference
+ * @param[in]  remove    If true, the order is removed (deleted or replaced)
+ *
+ * @return     The stock locate, 0 for unknown orders
+ */
+unsigned int Layout41::orderLocate(unsigned long long orderRef, bool remove) {
+  auto it = orders.find(orderRef);
+  if (it == orders.end()) return 0;
+  const unsigned int locate = it->second.locate;
+  if (remove) orders.erase(it);
+  return locate;
+}
+
+/**
+ * @brief      Returns the stock locate of an executed or cancelled order and reduces
+ *              its remaining shares, the order is removed once no shares remain
+ *
+ * @param[in]  orderRef  The order reference
+ * @param[in]  shares    The executed or cancelled shares
+ *
+ * @return     The stock locate, 0 for unknown orders
+ */
+unsigned int Layout41::reduceOrder(unsigned long long orderRef, unsigned int shares) {
+  auto it = orders.find(orderRef);
+  if (it == orders.end()) return 0;
+  const unsigned int locate = it->second.locate;
+  if (shares >= it->second.shares) {
+    orders.erase(it);
+  } else {
+    it->second.shares -= shares;
+  }
+  return locate;
+}
+
+/**
+ * @brief      Returns the stock locate of a stock, new stocks get the next stock locate
+ *
+ * @param[in]  stock  The raw stock (8 characters)
+ *
+ * @return     The stock locate
+ */
+unsigned int Layout41::stockLocate(unsigned long long stock) {
+  auto it = locates.find(stock);
+  if (it != locates.end()) return it->second;
+
+  const unsigned int locate = locates.size() + 1;
+  if (locate > 65535) Rcpp::stop("More than 65535 stocks in the file");
+  locates[stock] = locate;
+  return locate;
+}
@@ -0,0 +1,75 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <Rcpp.h>
+#include <unordered_map>
+#include "MessageTypes.h"
+#include "Specifications.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * The layouts of the ITCH versions. The decoders (see MessageTypes.h)
+ *  read the ITCH 5.0 layout, a layout frames the messages of its version
+ *  and passes them on in the 5.0 layout:
+ *  - Layout50: ITCH 5.0, the messages are passed on in place
+ *  - Layout41: ITCH 4.1, each message is rewritten into the 5.0 layout:
+ *     the timestamp is the nanoseconds since midnight (the seconds of the
+ *     last 'T' message and the nanoseconds of the message), the tracking
+ *     number is 0, and the stock locate codes are assigned in the order in
+ *     which the stocks appear (as the stock directory of 5.0), modifications
+ *     take the stock locate of their order. 'T' messages are not passed on.
+ *
+ * The loops that frame a buffer (see loadToMessages and countMessages)
+ *  are templates of the layout, thus each version has its own inlined loop.
+ *  detectVersion() finds the version from the first messages of a file.
+ * #################################################################
+ */
+
+// see RITCH.h
+unsigned long long getMessageLength(unsigned char msgType);
+
+enum ITCHVersion {
+  ITCH_50 = 50,
+  ITCH_41 = 41
+};
+
+ITCHVersion detectVersion(unsigned char* buf, unsigned long long size);
+unsigned long long getMessageLength41(unsigned char msgType, bool warn = true);
+unsigned char* convertToLayout50(unsigned char* data, unsigned long long size, unsigned long long& newSize);
+
+class Layout50 {
+public:
+  // Functions
+  static unsigned long long length(unsigned char msgType) { return getMessageLength(msgType); }
+  static bool isData(unsigned char) { return true; }
+  unsigned char* normalize(unsigned char* buf) { return buf; }
+};
+
+class Layout41 {
+public:
+  // Functions
+  static unsigned long long length(unsigned char msgType) { return getMessageLength41(msgType); }
+  static bool isData(unsigned char msgType) { return msgType != 'T'; }
+  unsigned char* normalize(unsigned char* buf);
+
+private:
+  // the stock locate and the remaining shares of an order
+  struct Order {
+    unsigned int locate;
+    unsigned int shares;
+  };
+
+  unsigned int getLocate(unsigned char* msg);
+  unsigned int orderLocate(unsigned long long orderRef, bool remove);
+  unsigned int reduceOrder(unsigned long long orderRef, unsigned int shares);
+  unsigned int stockLocate(unsigned long long stock);
+
+  // Members
+  unsigned char out[64]; // the message in the 5.0 layout, valid until the next message
+  unsigned long long seconds = 0;
+  std::unordered_map<unsigned long long, unsigned int> locates; // by the raw stock
+  std::unordered_map<unsigned long long, Order> orders;          // the open orders by their reference
+};
+
+#endif //LAYOUT_H
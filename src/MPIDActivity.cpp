@@ -0,0 +1,232 @@
+#include "MPIDActivity.h"
+#include <algorithm>
+#include "DataFrameBuilder.h"
+#include "RITCH.h"
+#include "Session.h"
+
+/**
+ * @brief      Returns the activity of a participant in a stock, a new activity is added if needed
+ *
+ * @param[in]  mpid        The raw MPID
+ * @param[in]  locateCode  The stock locate code
+ *
+ * @return     The index of the activity
+ */
+unsigned long long MPIDActivity::getActivity(unsigned int mpid, unsigned int locateCode) {
+  const unsigned long long key = ((unsigned long long) mpid << 32) | locateCode;
+  auto it = activityIndex.find(key);
+  if (it != activityIndex.end()) return it->second;
+
+  Activity activity;
+  activity.mpid       = mpid;
+  activity.locateCode = locateCode;
+  activity.stock      = 0;
+  activities.push_back(activity);
+  activityIndex.emplace(key, activities.size() - 1);
+  return activities.size() - 1;
+}
+
+/**
+ * @brief      Adds a message to the activity of its participant, the modifications
+ *              are only counted for attributed orders that are known
+ *
+ * @param      buf   The buffer
+ *
+ * @return     false if the boundaries are broken (all necessary messages are already loaded),
+ *              thus the loading process can be aborted, otherwise true
+ */
+bool MPIDActivity::loadMessages(unsigned char* buf) {
+
+  // first check if this is the wrong message
+  bool rightMessage = false;
+  for (unsigned char type : validTypes) {
+    rightMessage = rightMessage || buf[0] == type;
+  }
+
+  // if the message is of the wrong type, terminate here, but continue with the next message
+  if (!rightMessage) return true;
+
+  // if the message is out of bounds (i.e., we dont want to collect it yet!)
+  if (messageCount < startMsgCount) {
+    ++messageCount;
+    return true;
+  }
+
+  // if the message is out of bounds (i.e., we dont want to collect it ever,
+  // thus aborting the information gathering (return false!))
+  if (messageCount > endMsgCount) return false;
+  ++messageCount;
+
+  if (buf[0] == 'L') {
+    if (!positions) return true;
+    Activity& a = activities[getActivity(get4bytes(&buf[11]), get2bytes(&buf[1]))];
+    a.stock              = get8bytes(&buf[15]);
+    a.primaryMarketMaker = buf[23];
+    a.marketMakerMode    = buf[24];
+    a.participantState   = buf[25];
+    return true;
+  }
+
+  if (buf[0] == 'F') {
+    const unsigned long long index = getActivity(get4bytes(&buf[36]), get2bytes(&buf[1]));
+    Activity& a = activities[index];
+    const unsigned long long shares = get4bytes(&buf[20]);
+    a.stock = get8bytes(&buf[24]);
+    ++a.orders;
+    if (buf[19] == 'B') ++a.buyOrders;
+    a.shares += shares;
+    openOrders[get8bytes(&buf[11])] = OpenOrder{index, shares};
+    return true;
+  }
+
+  // the modifications, the order reference follows the timestamp
+  auto it = openOrders.find(get8bytes(&buf[11]));
+  if (it == openOrders.end()) return true;
+  OpenOrder& order = it->second;
+  Activity& a = activities[order.activity];
+
+  switch (buf[0]) {
+  case 'E':
+  case 'C': {
+    const unsigned long long shares = std::min<unsigned long long>(get4bytes(&buf[19]), order.shares);
+    ++a.executions;
+    a.executedShares += shares;
+    order.shares     -= shares;
+    // a fully executed order is removed without a delete message
+    if (order.shares == 0) openOrders.erase(it);
+    break;
+  }
+  case 'X': {
+    const unsigned long long shares = std::min<unsigned long long>(get4bytes(&buf[19]), order.shares);
+    a.canceledShares += shares;
+    order.shares     -= shares;
+    break;
+  }
+  case 'D':
+    ++a.deletes;
+    a.canceledShares += order.shares;
+    openOrders.erase(it);
+    break;
+  case 'U': {
+    // the replaced shares are canceled, the new order keeps the attribution
+    const OpenOrder replacement{order.activity, get4bytes(&buf[27])};
+    ++a.replaces;
+    a.canceledShares += order.shares;
+    a.shares         += replacement.shares;
+    openOrders.erase(it);
+    openOrders[get8bytes(&buf[19])] = replacement;
+    break;
+  }
+  }
+  return true;
+}
+
+/**
+ * @brief      Converts the activities into an Rcpp::DataFrame, one row per participant and stock
+ *
+ * @return     The Rcpp::DataFrame
+ */
+Rcpp::DataFrame MPIDActivity::getDF() {
+  const unsigned long long n = activities.size();
+  std::vector<unsigned int> mpid(n), locateCode(n);
+  std::vector<unsigned long long> stock(n), orders(n), buyOrders(n), shares(n), executions(n),
+    executedShares(n), canceledShares(n), deletes(n), replaces(n);
+  std::vector<char> primaryMarketMaker(n), marketMakerMode(n), participantState(n);
+
+  for (unsigned long long i = 0; i < n; ++i) {
+    const Activity& a = activities[i];
+    mpid[i]               = a.mpid;
+    locateCode[i]         = a.locateCode;
+    stock[i]              = a.stock;
+    orders[i]             = a.orders;
+    buyOrders[i]          = a.buyOrders;
+    shares[i]             = a.shares;
+    executions[i]         = a.executions;
+    executedShares[i]     = a.executedShares;
+    canceledShares[i]     = a.canceledShares;
+    deletes[i]            = a.deletes;
+    replaces[i]           = a.replaces;
+    primaryMarketMaker[i] = a.primaryMarketMaker;
+    marketMakerMode[i]    = a.marketMakerMode;
+    participantState[i]   = a.participantState;
+  }
+
+  DataFrameBuilder df(n);
+  df.addSymbol( "mpid",            mpid);
+  df.addNumeric("locate_code",     locateCode);
+  df.addSymbol( "stock",           stock);
+  df.addNumeric("orders",          orders);
+  df.addNumeric("buy_orders",      buyOrders);
+  df.addNumeric("shares",          shares);
+  df.addNumeric("executions",      executions);
+  df.addNumeric("executed_shares", executedShares);
+  df.addNumeric("canceled_shares", canceledShares);
+  df.addNumeric("deletes",         deletes);
+  df.addNumeric("replaces",        replaces);
+  if (positions) {
+    df.addChar("primary_market_maker", primaryMarketMaker);
+    df.addChar("market_maker_mode",    marketMakerMode);
+    df.addChar("participant_state",    participantState);
+  }
+
+  return df.build();
+}
+
+
+// @brief      Returns the activity of the market participants from a file as a dataframe
+//
+// The attributed orders ('F') and their modifications ('E', 'C', 'X', 'D', 'U') are
+// aggregated by MPID and stock, the market participant positions ('L') are added
+//
+// @param[in]  filename       The filename to a plain-text-file, "-" for stdin, or "| cmd"
+// @param[in]  bufferSize     The buffer size in bytes, 0 chooses the size automatically
+// @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+// @param[in]  marketSession  The market session to load, 0 all, 1 pre-market, 2 regular, 3 post-market
+// @param[in]  tradingMode    The use of the trading state, 0 keep, 2 drop halted/paused/quoted stocks
+// @param[in]  positions      If true, the market participant positions are added
+// @param[in]  quiet          If true, no status message is printed
+//
+// @return     The activity in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame getMPIDActivity_impl(std::string filename,
+                                     unsigned long long bufferSize,
+                                     Rcpp::IntegerVector stockLocate,
+                                     int marketSession,
+                                     int tradingMode,
+                                     bool positions,
+                                     bool quiet) {
+  if (tradingMode == TRADING_TAG) Rcpp::stop("trading_state has to be one of 'keep' or 'drop'");
+  MPIDActivity activity(positions);
+
+  // the activity is aggregated in a single pass, no need to count the messages first
+  if (!quiet) Rcpp::Rcout << "[Loading]    ";
+  loadToMessages(filename, activity, 0, std::numeric_limits<unsigned long long>::max(), bufferSize, quiet,
+                 MessageFilter::create(stockLocate, marketSession, tradingMode));
+
+  if (!quiet) Rcpp::Rcout << "\n[Converting] to data.table\n";
+  return activity.getDF();
+}
+
+// @brief      Returns the activity of the market participants from a session as a dataframe
+//
+// @param[in]  session        The external pointer to the session
+// @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+// @param[in]  marketSession  The market session to load, 0 all, 1 pre-market, 2 regular, 3 post-market
+// @param[in]  tradingMode    The use of the trading state, 0 keep, 2 drop halted/paused/quoted stocks
+// @param[in]  positions      If true, the market participant positions are added
+// @param[in]  quiet          If true, no status message is printed
+//
+// @return     The activity in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame getSessionMPIDActivity_impl(SEXP session,
+                                            Rcpp::IntegerVector stockLocate,
+                                            int marketSession,
+                                            int tradingMode,
+                                            bool positions,
+                                            bool quiet) {
+  if (tradingMode == TRADING_TAG) Rcpp::stop("trading_state has to be one of 'keep' or 'drop'");
+  MPIDActivity activity(positions);
+  return getSessionMessagesTemplate(activity, session, 0, 0, stockLocate, marketSession, tradingMode, quiet);
+}
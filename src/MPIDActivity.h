@@ -0,0 +1,72 @@
+#ifndef MPIDACTIVITY_H
+#define MPIDACTIVITY_H
+
+#include <Rcpp.h>
+#include <vector>
+#include <unordered_map>
+#include "MessageTypes.h"
+#include "Specifications.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * MPIDActivity aggregates the attributed order flow by market participant
+ *  (MPID) and stock while the file is parsed, instead of loading each order.
+ *
+ * The attributed orders ('F') are tracked by their order reference number,
+ *  thus the executions ('E', 'C'), cancellations ('X'), deletions ('D'),
+ *  and replacements ('U', the new order keeps the attribution) of an order
+ *  are assigned to its participant. Orders that were added before the
+ *  loaded messages are not known and their modifications are ignored.
+ *
+ * The market participant position messages ('L') add the market maker
+ *  status of a participant in a stock (the last message is kept).
+ * #################################################################
+ */
+
+class MPIDActivity : public MessageType {
+public:
+  explicit MPIDActivity(bool positions = true) :
+    MessageType({'F', 'E', 'C', 'X', 'D', 'U', 'L'},
+      {ITCH::POS::F, ITCH::POS::E, ITCH::POS::C, ITCH::POS::X, ITCH::POS::D, ITCH::POS::U, ITCH::POS::L}),
+    positions(positions) {}
+  // Functions
+  bool loadMessages(unsigned char* buf);
+  void reserve(unsigned long long) {} // the number of participants is small
+  Rcpp::DataFrame getDF();
+
+private:
+  // the activity of one participant in one stock
+  struct Activity {
+    unsigned int       mpid;  // raw 4 characters
+    unsigned int       locateCode;
+    unsigned long long stock; // raw 8 characters, 0 until known
+    unsigned long long orders         = 0;
+    unsigned long long buyOrders      = 0;
+    unsigned long long shares         = 0;
+    unsigned long long executions     = 0;
+    unsigned long long executedShares = 0;
+    unsigned long long canceledShares = 0;
+    unsigned long long deletes        = 0;
+    unsigned long long replaces       = 0;
+    // the last market participant position ('L'), 0 if not known
+    char primaryMarketMaker = 0;
+    char marketMakerMode    = 0;
+    char participantState   = 0;
+  };
+  // an open attributed order
+  struct OpenOrder {
+    unsigned long long activity; // the index into activities
+    unsigned long long shares;   // the remaining shares
+  };
+
+  unsigned long long getActivity(unsigned int mpid, unsigned int locateCode);
+
+  // Members
+  bool positions;
+  std::vector<Activity> activities;
+  std::unordered_map<unsigned long long, unsigned long long> activityIndex; // by MPID and locate code
+  std::unordered_map<unsigned long long, OpenOrder> openOrders;             // by order reference
+};
+
+#endif //MPIDACTIVITY_H
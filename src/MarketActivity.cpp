@@ -0,0 +1,231 @@
+#include "MarketActivity.h"
+#include <algorithm>
+#include <cmath>
+#include "DataFrameBuilder.h"
+#include "RITCH.h"
+#include "Session.h"
+
+/**
+ * @brief      Applies the pending modifications and closes the last bucket
+ */
+void MarketActivity::finish() {
+  flush();
+  if (!buckets.empty()) closeBucket();
+}
+
+/**
+ * @brief      Counts a message in its bucket, adds its trade, and applies it to the book
+ *
+ * @param      buf   The buffer
+ */
+void MarketActivity::onApply(unsigned char* buf) {
+  Bucket& b = getBucket(buf);
+  const unsigned int locate = get2bytes(&buf[1]);
+
+  switch (buf[0]) {
+  case 'A':
+  case 'F':
+    ++b.adds;
+    break;
+  case 'E': {
+    ++b.executions;
+    // the execution price is the price of the order
+    const BookOrder* order = book.find(get8bytes(&buf[11]));
+    if (order != NULL) addTrade(locate, get4bytes(&buf[19]), order->price);
+    break;
+  }
+  case 'C':
+    ++b.executions;
+    // non-printable executions are part of a cross, which is counted by its 'Q' message
+    if (buf[31] == 'Y') addTrade(locate, get4bytes(&buf[19]), get4bytes(&buf[32]));
+    break;
+  case 'X':
+    ++b.cancels;
+    break;
+  case 'D':
+    ++b.deletes;
+    break;
+  case 'U':
+    ++b.replaces;
+    break;
+  case 'P':
+    ++b.executions;
+    addTrade(locate, get4bytes(&buf[20]), get4bytes(&buf[32]));
+    return;
+  case 'Q': {
+    ++b.crosses;
+    const unsigned long long shares = get8bytes(&buf[11]);
+    if (shares > 0) addTrade(locate, shares, get4bytes(&buf[27]));
+    return;
+  }
+  default:
+    return;
+  }
+  book.update(buf);
+}
+
+/**
+ * @brief      Returns the bucket of a message, the current bucket is closed
+ *              once a message of a later bucket is seen. The stock of the message is
+ *              counted as active in the bucket
+ *
+ * @param      buf   The buffer
+ *
+ * @return     The bucket, messages with an earlier timestamp are added to the current bucket
+ */
+MarketActivity::Bucket& MarketActivity::getBucket(unsigned char* buf) {
+  const long long index = get6bytes(&buf[5]) / resolution;
+  if (buckets.empty() || index > buckets.back().index) {
+    if (!buckets.empty()) closeBucket();
+    buckets.emplace_back();
+    buckets.back().index = index;
+  }
+  Bucket& b = buckets.back();
+  ++b.messages;
+
+  const unsigned int locate = get2bytes(&buf[1]);
+  if (locate >= prices.size()) prices.resize(locate + 1);
+  if (prices[locate].active != b.index) {
+    prices[locate].active = b.index;
+    ++b.activeStocks;
+  }
+  return b;
+}
+
+/**
+ * @brief      Adds a trade to the current bucket
+ *
+ * @param[in]  locate  The stock locate code
+ * @param[in]  shares  The traded shares
+ * @param[in]  price   The price in 1e-4 dollars
+ */
+void MarketActivity::addTrade(unsigned int locate, unsigned long long shares, unsigned int price) {
+  Bucket& b = buckets.back();
+  ++b.trades;
+  b.shares   += shares;
+  b.notional += (double) shares * price / 10000.0;
+
+  StockPrices& s = prices[locate];
+  if (s.traded != b.index) {
+    s.traded = b.index;
+    ++b.tradedStocks;
+    tradedLocates.push_back(locate);
+  }
+  if (price > 0) s.current = price;
+}
+
+/**
+ * @brief      Adds the returns of the stocks that traded in the current bucket,
+ *              the last trade price of the bucket becomes the reference of the next return
+ */
+void MarketActivity::closeBucket() {
+  Bucket& b = buckets.back();
+  for (unsigned int locate : tradedLocates) {
+    StockPrices& s = prices[locate];
+    if (s.last > 0 && s.current > 0) {
+      const double ret = std::log((double) s.current / (double) s.last);
+      ++b.returns;
+      b.sumReturns += ret;
+      b.sumSquares += ret * ret;
+    }
+    s.last = s.current;
+  }
+  tradedLocates.clear();
+}
+
+/**
+ * @brief      Converts the buckets into an Rcpp::DataFrame,
+ *              the numeric columns are filled in parallel
+ *
+ * @return     The Rcpp::DataFrame with one row per bucket that has a message
+ */
+Rcpp::DataFrame MarketActivity::getDF() {
+  Column<unsigned long long> timestamp, messages, adds, executions, cancels, deletes, replaces,
+                             crosses, trades, shares, activeStocks, tradedStocks, returns;
+  Column<double> notional, meanReturn, dispersion;
+
+  for (Bucket const& b : buckets) {
+    timestamp.push_back(    b.index * resolution );
+    messages.push_back(     b.messages );
+    adds.push_back(         b.adds );
+    executions.push_back(   b.executions );
+    cancels.push_back(      b.cancels );
+    deletes.push_back(      b.deletes );
+    replaces.push_back(     b.replaces );
+    crosses.push_back(      b.crosses );
+    trades.push_back(       b.trades );
+    shares.push_back(       b.shares );
+    notional.push_back(     b.notional );
+    activeStocks.push_back( b.activeStocks );
+    tradedStocks.push_back( b.tradedStocks );
+    returns.push_back(      b.returns );
+    meanReturn.push_back(   b.returns > 0 ? b.sumReturns / b.returns : NA_REAL );
+    // the sample standard deviation, rounding errors can make the variance slightly negative
+    const double variance = b.returns > 1 ?
+      (b.sumSquares - b.sumReturns * b.sumReturns / b.returns) / (b.returns - 1) : NA_REAL;
+    dispersion.push_back(   b.returns > 1 ? std::sqrt(std::max(variance, 0.0)) : NA_REAL );
+  }
+
+  DataFrameBuilder df(timestamp.size());
+  df.addNumeric("timestamp",         timestamp);
+  df.addNumeric("messages",          messages);
+  df.addNumeric("adds",              adds);
+  df.addNumeric("executions",        executions);
+  df.addNumeric("cancels",           cancels);
+  df.addNumeric("deletes",           deletes);
+  df.addNumeric("replaces",          replaces);
+  df.addNumeric("crosses",           crosses);
+  df.addNumeric("trades",            trades);
+  df.addNumeric("shares",            shares);
+  df.addNumeric("notional",          notional);
+  df.addNumeric("active_stocks",     activeStocks);
+  df.addNumeric("traded_stocks",     tradedStocks);
+  df.addNumeric("n_returns",         returns);
+  df.addNumeric("mean_return",       meanReturn);
+  df.addNumeric("return_dispersion", dispersion);
+
+  return df.build();
+}
+
+
+// @brief      Returns the market-wide aggregates of a file by time bucket
+//
+// @param[in]  filename     The filename to a plain-text-file, "-" for stdin, or "| cmd"
+// @param[in]  bufferSize   The buffer size in bytes, 0 chooses the size automatically
+// @param[in]  resolution   The length of the buckets in nanoseconds
+// @param[in]  stockLocate  The stock locate codes to load, empty for all stocks
+// @param[in]  quiet        If true, no status message is printed
+//
+// @return     The aggregates in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame getMarketActivity_impl(std::string filename,
+                                       unsigned long long bufferSize,
+                                       double resolution,
+                                       Rcpp::IntegerVector stockLocate,
+                                       bool quiet) {
+  MarketActivity activity(resolution);
+
+  activity.replayFile(filename, bufferSize, quiet, MessageFilter::create(stockLocate, MARKET_ALL, TRADING_KEEP));
+
+  if (!quiet) Rcpp::Rcout << "\n[Converting] to data.table\n";
+  return activity.getDF();
+}
+
+// @brief      Returns the market-wide aggregates of a session by time bucket
+//
+// @param[in]  session      The external pointer to the session
+// @param[in]  resolution   The length of the buckets in nanoseconds
+// @param[in]  stockLocate  The stock locate codes to load, empty for all stocks
+// @param[in]  quiet        If true, no status message is printed
+//
+// @return     The aggregates in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame getSessionMarketActivity_impl(SEXP session,
+                                              double resolution,
+                                              Rcpp::IntegerVector stockLocate,
+                                              bool quiet) {
+  MarketActivity activity(resolution);
+  return getSessionMessagesTemplate(activity, session, 0, 0, stockLocate, MARKET_ALL, TRADING_KEEP, quiet);
+}
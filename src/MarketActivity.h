@@ -0,0 +1,83 @@
+#ifndef MARKETACTIVITY_H
+#define MARKETACTIVITY_H
+
+#include <Rcpp.h>
+#include <vector>
+#include "BookReplay.h"
+#include "OrderBook.h"
+#include "Specifications.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * MarketActivity aggregates the messages of all stocks by time bucket
+ *  while the file is parsed, thus market-wide time series (i.e., the
+ *  traded volume per minute) do not need the messages in R.
+ *
+ * The buckets are consecutive intervals of a fixed resolution, a bucket
+ *  is closed once the first message of a later bucket is seen. Per bucket:
+ *  - the number of messages: additions ('A', 'F'), executions ('E', 'C', 'P'),
+ *     cancellations ('X'), deletions ('D'), replacements ('U'), and crosses ('Q')
+ *  - the trades, their shares, and their notional (shares times price):
+ *     executions of known orders (the order book is replayed to find the
+ *     price of 'E' messages), printable executions with price ('C'),
+ *     non-displayed trades ('P'), and crosses with shares ('Q')
+ *  - the number of stocks with messages and with trades
+ *  - the cross-sectional mean and standard deviation of the log returns
+ *     of the traded stocks, the return of a stock is taken from the
+ *     last trade price of the bucket and the last trade price before it
+ * #################################################################
+ */
+
+class MarketActivity : public BookReplay {
+public:
+  explicit MarketActivity(unsigned long long resolution) :
+    BookReplay({'A', 'F', 'E', 'C', 'X', 'D', 'U', 'P', 'Q'},
+      {ITCH::POS::A, ITCH::POS::F, ITCH::POS::E, ITCH::POS::C, ITCH::POS::X,
+       ITCH::POS::D, ITCH::POS::U, ITCH::POS::P, ITCH::POS::Q}),
+    resolution(resolution) {}
+  // Functions
+  void reserve(unsigned long long) {} // the number of buckets is small
+  Rcpp::DataFrame getDF();
+  void finish();
+
+private:
+  // the aggregates of one time bucket
+  struct Bucket {
+    long long          index;
+    unsigned long long messages   = 0;
+    unsigned long long adds       = 0;
+    unsigned long long executions = 0;
+    unsigned long long cancels    = 0;
+    unsigned long long deletes    = 0;
+    unsigned long long replaces   = 0;
+    unsigned long long crosses    = 0;
+    unsigned long long trades     = 0;
+    unsigned long long shares     = 0;
+    double             notional   = 0;
+    unsigned long long activeStocks = 0;
+    unsigned long long tradedStocks = 0;
+    unsigned long long returns    = 0;
+    double             sumReturns = 0;
+    double             sumSquares = 0;
+  };
+  // the trade prices of a stock
+  struct StockPrices {
+    long long    active = -1; // the last bucket with a message
+    long long    traded = -1; // the last bucket with a trade
+    unsigned int last    = 0; // the last trade price before the traded bucket, 0 if none
+    unsigned int current = 0; // the last trade price of the traded bucket
+  };
+
+  void onApply(unsigned char* buf);
+  void addTrade(unsigned int locate, unsigned long long shares, unsigned int price);
+  Bucket& getBucket(unsigned char* buf);
+  void closeBucket();
+
+  unsigned long long resolution; // in nanoseconds
+  std::vector<Bucket> buckets;
+  std::vector<StockPrices> prices;         // by locate code
+  std::vector<unsigned int> tradedLocates; // the stocks with trades in the current bucket
+};
+
+#endif //MARKETACTIVITY_H
@@ -0,0 +1,141 @@
+#include "Memory.h"
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// the size of a (2MB) huge page
+static const std::size_t HUGE_PAGE_SIZE = 1ULL << 21;
+
+// the kind of memory backing an mmapped block
+enum MemoryKind { KIND_EXPLICIT, KIND_TRANSPARENT, KIND_REGULAR };
+
+struct MappedBlock {
+  std::size_t length;
+  MemoryKind kind;
+};
+
+static HugePageMode hugePageMode = HUGEPAGES_OFF;
+static MemoryStats memoryStats;
+// the blocks that were mmapped (everything else was malloced)
+static std::unordered_map<void*, MappedBlock> mappedBlocks;
+static std::mutex memoryMutex;
+
+/**
+ * @brief      Adds or subtracts a block from the memory statistics
+ *
+ * @param[in]  kind   The kind of memory
+ * @param[in]  bytes  The number of bytes
+ * @param[in]  add    true if the block was allocated, false if it was freed
+ */
+static void countMemory(MemoryKind kind, unsigned long long bytes, bool add) {
+  unsigned long long& count = kind == KIND_EXPLICIT    ? memoryStats.explicitBytes :
+                              kind == KIND_TRANSPARENT ? memoryStats.transparentBytes :
+                                                         memoryStats.regularBytes;
+  if (add) count += bytes; else count -= bytes;
+}
+
+void setHugePageMode(HugePageMode mode) { hugePageMode = mode; }
+HugePageMode getHugePageMode() { return hugePageMode; }
+
+MemoryStats getMemoryStats() {
+  std::lock_guard<std::mutex> lock(memoryMutex);
+  return memoryStats;
+}
+
+/**
+ * @brief      Allocates a block of memory, backed by huge pages if enabled
+ *
+ * @param[in]  bytes  The number of bytes
+ *
+ * @return     The pointer to the block, NULL if the allocation failed
+ */
+void* allocateMemory(std::size_t bytes) {
+#ifdef __linux__
+  if (hugePageMode != HUGEPAGES_OFF && bytes >= HUGE_PAGE_SIZE) {
+    const std::size_t length = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    void* ptr = MAP_FAILED;
+    MemoryKind kind = KIND_REGULAR;
+
+#ifdef MAP_HUGETLB
+    if (hugePageMode == HUGEPAGES_EXPLICIT) {
+      ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, 
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (ptr != MAP_FAILED) kind = KIND_EXPLICIT;
+    }
+#endif
+    // no (or not enough) reserved huge pages: fall back to transparent huge pages
+    if (ptr == MAP_FAILED) {
+      ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ptr == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+      if (madvise(ptr, length, MADV_HUGEPAGE) == 0) kind = KIND_TRANSPARENT;
+#endif
+    }
+
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    mappedBlocks[ptr] = MappedBlock{length, kind};
+    countMemory(kind, length, true);
+    return ptr;
+  }
+#endif
+  
+  void* ptr = malloc(bytes);
+  if (ptr != NULL) {
+    std::lock_guard<std::mutex> lock(memoryMutex);
+    countMemory(KIND_REGULAR, bytes, true);
+  }
+  return ptr;
+}
+
+/**
+ * @brief      Frees a block that was allocated by allocateMemory
+ *
+ * @param      ptr    The pointer to the block
+ * @param[in]  bytes  The number of bytes that were requested
+ */
+void freeMemory(void* ptr, std::size_t bytes) {
+  if (ptr == NULL) return;
+  std::lock_guard<std::mutex> lock(memoryMutex);
+  
+#ifdef __linux__
+  auto it = mappedBlocks.find(ptr);
+  if (it != mappedBlocks.end()) {
+    countMemory(it->second.kind, it->second.length, false);
+    munmap(ptr, it->second.length);
+    mappedBlocks.erase(it);
+    return;
+  }
+#endif
+
+  countMemory(KIND_REGULAR, bytes, false);
+  free(ptr);
+}
+
+
+// @brief      Sets if huge pages are used for the large allocations
+//
+// @param[in]  mode  0 (off), 1 (transparent huge pages), or 2 (explicit huge pages)
+//
+// [[Rcpp::export]]
+void setHugePages_impl(int mode) {
+  if (mode < HUGEPAGES_OFF || mode > HUGEPAGES_EXPLICIT) Rcpp::stop("Unknown huge page mode");
+  setHugePageMode(static_cast<HugePageMode>(mode));
+}
+
+// @brief      Returns the huge page mode and the currently allocated memory by its backing
+//
+// @return     A list with the mode and the allocated bytes
+//
+// [[Rcpp::export]]
+Rcpp::List getHugePages_impl() {
+  MemoryStats stats = getMemoryStats();
+  return Rcpp::List::create(
+    Rcpp::Named("mode")              = (int) getHugePageMode(),
+    Rcpp::Named("explicit_bytes")    = (double) stats.explicitBytes,
+    Rcpp::Named("transparent_bytes") = (double) stats.transparentBytes,
+    Rcpp::Named("regular_bytes")     = (double) stats.regularBytes
+  );
+}
@@ -0,0 +1,69 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <Rcpp.h>
+#include <vector>
+#include <new>
+#include <cstddef>
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * Allocation of the large blocks (the parse buffer and the content vectors 
+ *  of the MessageTypes), which can be backed by huge pages to reduce TLB misses:
+ *  - HUGEPAGES_OFF:         plain malloc (the default)
+ *  - HUGEPAGES_TRANSPARENT: mmap + madvise(MADV_HUGEPAGE)
+ *  - HUGEPAGES_EXPLICIT:    mmap with MAP_HUGETLB (needs reserved huge pages),
+ *                            falls back to transparent huge pages
+ * Blocks smaller than a huge page always use malloc.
+ * #################################################################
+ */
+
+enum HugePageMode {
+  HUGEPAGES_OFF         = 0,
+  HUGEPAGES_TRANSPARENT = 1,
+  HUGEPAGES_EXPLICIT    = 2
+};
+
+// the currently allocated bytes by their backing
+struct MemoryStats {
+  unsigned long long explicitBytes    = 0;
+  unsigned long long transparentBytes = 0;
+  unsigned long long regularBytes     = 0;
+};
+
+void setHugePageMode(HugePageMode mode);
+HugePageMode getHugePageMode();
+MemoryStats getMemoryStats();
+
+void* allocateMemory(std::size_t bytes);
+void freeMemory(void* ptr, std::size_t bytes);
+
+/**
+ * @brief      An allocator for the content vectors, which uses allocateMemory
+ */
+template <typename T>
+struct ColumnAllocator {
+  typedef T value_type;
+
+  ColumnAllocator() = default;
+  template <typename U> ColumnAllocator(ColumnAllocator<U> const&) {}
+
+  T* allocate(std::size_t n) {
+    void* ptr = allocateMemory(n * sizeof(T));
+    if (ptr == NULL) throw std::bad_alloc();
+    return static_cast<T*>(ptr);
+  }
+  void deallocate(T* ptr, std::size_t n) { freeMemory(ptr, n * sizeof(T)); }
+};
+
+template <typename T, typename U>
+bool operator==(ColumnAllocator<T> const&, ColumnAllocator<U> const&) { return true; }
+template <typename T, typename U>
+bool operator!=(ColumnAllocator<T> const&, ColumnAllocator<U> const&) { return false; }
+
+// a content vector of a MessageType
+template <typename T>
+using Column = std::vector<T, ColumnAllocator<T>>;
+
+#endif //MEMORY_H
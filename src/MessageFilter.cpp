@@ -0,0 +1,112 @@
+#include "MessageFilter.h"
+#include <algorithm>
+
+/**
+ * @brief      Creates a filter
+ *
+ * @param[in]  locates        A vector that is true for each stock locate code that is loaded,
+ *                              empty for all stocks
+ * @param[in]  marketSession  The market session that is loaded
+ * @param[in]  tradingMode    How the trading state of the stocks is used
+ */
+MessageFilter::MessageFilter(std::vector<bool> const& locates, MarketSession marketSession,
+                             TradingStateMode tradingMode) :
+  locates(locates), marketSession(marketSession),
+  // the pre-market and all messages start with the file, the others with a system event
+  inSession(marketSession == MARKET_ALL || marketSession == MARKET_PRE),
+  tradingMode(tradingMode) {
+  // the stocks are trading until a trading action says otherwise
+  if (tradingMode != TRADING_KEEP) tradingStates.assign(1 << 16, ITCH::TRADING::TRADING);
+}
+
+/**
+ * @brief      Creates a filter from the arguments of the R functions
+ *
+ * @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+ * @param[in]  marketSession  The market session to load (see MarketSession)
+ * @param[in]  tradingMode    How the trading state is used (see TradingStateMode)
+ *
+ * @return     The filter
+ */
+MessageFilter MessageFilter::create(Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode) {
+  if (marketSession < MARKET_ALL || marketSession > MARKET_POST)
+    Rcpp::stop("market_session has to be one of 'all', 'pre', 'regular', or 'post'");
+  if (tradingMode < TRADING_KEEP || tradingMode > TRADING_DROP)
+    Rcpp::stop("trading_state has to be one of 'keep', 'tag', or 'drop'");
+
+  std::vector<bool> locates;
+  if (stockLocate.size() > 0) {
+    // the stock locate is a 2 byte field
+    locates.assign(1 << 16, false);
+    for (int locate : stockLocate) {
+      if (locate == NA_INTEGER || locate < 0 || locate >= (1 << 16))
+        Rcpp::stop("stock_locate has to be between 0 and 65535");
+      locates[locate] = true;
+    }
+  }
+  return MessageFilter(locates, static_cast<MarketSession>(marketSession), 
+                       static_cast<TradingStateMode>(tradingMode));
+}
+
+/**
+ * @brief      Returns the stock locate codes that are loaded
+ *
+ * @return     The sorted stock locate codes, empty for all stocks
+ */
+std::vector<int> MessageFilter::getLocates() const {
+  std::vector<int> res;
+  for (unsigned long long i = 0; i < locates.size(); ++i) {
+    if (locates[i]) res.push_back(i);
+  }
+  return res;
+}
+
+/**
+ * @brief      Finds the part of a file that belongs to the market session
+ *
+ * @param      data          The content of the file
+ * @param[in]  eventOffsets  The offsets of the system event messages ('S') in the file
+ * @param      begin         The first offset of the session, only increased
+ * @param      end           The offset after the session, only decreased
+ */
+void MessageFilter::getRange(unsigned char* data,
+                             Column<unsigned long long> const& eventOffsets,
+                             unsigned long long& begin,
+                             unsigned long long& end) const {
+  if (marketSession == MARKET_ALL) return;
+
+  bool started = marketSession == MARKET_PRE;
+  for (unsigned long long offset : eventOffsets) {
+    const unsigned char event = data[offset + 11];
+    if (event == ITCH::EVENT::START_MARKET) {
+      if (marketSession == MARKET_PRE) {
+        end = std::min(end, offset);
+        return;
+      }
+      if (marketSession == MARKET_REGULAR) {
+        begin   = std::max(begin, offset);
+        started = true;
+      }
+    } else if (event == ITCH::EVENT::END_MARKET) {
+      if (marketSession == MARKET_REGULAR) {
+        end = std::min(end, offset);
+        return;
+      }
+      if (marketSession == MARKET_POST) {
+        begin   = std::max(begin, offset);
+        started = true;
+      }
+    }
+  }
+  // the session never started, nothing is loaded
+  if (!started) begin = end;
+}
+
+/**
+ * @brief      Loads all messages of the market session, used once the messages 
+ *              outside of the session are already excluded (see getRange)
+ */
+void MessageFilter::ignoreMarketSession() {
+  marketSession = MARKET_ALL;
+  inSession     = true;
+}
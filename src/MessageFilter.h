@@ -0,0 +1,130 @@
+#ifndef MESSAGEFILTER_H
+#define MESSAGEFILTER_H
+
+#include <Rcpp.h>
+#include <vector>
+#include "MessageTypes.h"
+#include "Specifications.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * MessageFilter decides which messages are passed to a MessageType,
+ *  the messages are checked before they are decoded:
+ *  - by the stock locate code
+ *  - by the market session, which is tracked by the system event
+ *     messages ('S', see ITCH::EVENT):
+ *     pre-market (until the start of market hours),
+ *     regular (from the start to the end of market hours),
+ *     or post-market (after the end of market hours)
+ *  - by the trading state of the stock, which is tracked by the stock
+ *     trading action messages ('H', see ITCH::TRADING), the messages of
+ *     halted, paused, or quotation only stocks can be dropped or tagged
+ *     with the trading state (column trading_state)
+ *
+ * The file loaders call load() for each message in the order of the file,
+ *  sessions (see Session.h) use getRange() to find the part of the file
+ *  that belongs to the market session and pass the trading actions in the
+ *  order of the file.
+ * #################################################################
+ */
+
+enum MarketSession {
+  MARKET_ALL     = 0,
+  MARKET_PRE     = 1,
+  MARKET_REGULAR = 2,
+  MARKET_POST    = 3
+};
+
+enum TradingStateMode {
+  TRADING_KEEP = 0, // all messages are loaded, the trading state is not tracked
+  TRADING_TAG  = 1, // all messages are loaded with the trading state of their stock
+  TRADING_DROP = 2  // only the messages of trading stocks are loaded
+};
+
+class MessageFilter {
+public:
+  // the result of check()
+  enum Action { LOAD, SKIP, STOP };
+
+  MessageFilter() = default;
+  MessageFilter(std::vector<bool> const& locates, MarketSession marketSession,
+                TradingStateMode tradingMode = TRADING_KEEP);
+  static MessageFilter create(Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode);
+
+  // Functions
+  inline Action check(unsigned char* buf);
+  inline bool load(MessageType& msg, unsigned char* buf);
+  bool isActive() const { 
+    return !locates.empty() || marketSession != MARKET_ALL || tradingMode == TRADING_DROP; 
+  }
+  TradingStateMode getTradingMode() const { return tradingMode; }
+  std::vector<int> getLocates() const;
+  void getRange(unsigned char* data,
+                Column<unsigned long long> const& eventOffsets,
+                unsigned long long& begin,
+                unsigned long long& end) const;
+  void ignoreMarketSession();
+
+private:
+  std::vector<bool> locates; // by stock locate code, empty for all stocks
+  MarketSession marketSession = MARKET_ALL;
+  bool inSession = true;
+  TradingStateMode tradingMode = TRADING_KEEP;
+  std::vector<unsigned char> tradingStates; // by stock locate code, empty if not tracked
+};
+
+/**
+ * @brief      Checks if a message is loaded, updates the market session on system events
+ *
+ * @param      buf   The buffer, starting at the message type
+ *
+ * @return     LOAD if the message should be loaded, SKIP if it is filtered, and
+ *              STOP if the market session has ended (no later message is loaded)
+ */
+inline MessageFilter::Action MessageFilter::check(unsigned char* buf) {
+  if (buf[0] == 'S' && marketSession != MARKET_ALL) {
+    const unsigned char event = buf[11];
+    if (event == ITCH::EVENT::START_MARKET) {
+      if (marketSession == MARKET_PRE) return STOP;
+      if (marketSession == MARKET_REGULAR) inSession = true;
+    } else if (event == ITCH::EVENT::END_MARKET) {
+      if (marketSession == MARKET_REGULAR) return STOP;
+      if (marketSession == MARKET_POST) inSession = true;
+    }
+  }
+  // the stock locate follows the message type in all messages
+  const unsigned int locate = get2bytes(&buf[1]);
+  if (buf[0] == 'H' && tradingMode != TRADING_KEEP) tradingStates[locate] = buf[19];
+  
+  if (!inSession) return SKIP;
+  if (!locates.empty() && !locates[locate]) return SKIP;
+  if (tradingMode == TRADING_DROP && tradingStates[locate] != ITCH::TRADING::TRADING) return SKIP;
+  return LOAD;
+}
+
+/**
+ * @brief      Checks a message and loads it into a MessageType, 
+ *              the loaded message is tagged with the trading state of its stock if requested
+ *
+ * @param      msg   The messagetype, or a subtype of it, which holds the information
+ * @param      buf   The buffer, starting at the message type
+ *
+ * @return     false if no later message is loaded (the market session has ended or 
+ *              the endMsgCount has been reached), otherwise true
+ */
+inline bool MessageFilter::load(MessageType& msg, unsigned char* buf) {
+  const Action action = check(buf);
+  if (action != LOAD) return action == SKIP;
+  if (tradingMode != TRADING_TAG) return msg.loadMessages(buf);
+
+  // a message is added to the content vectors if it is counted after the start count
+  const unsigned long long count = msg.messageCount;
+  if (!msg.loadMessages(buf)) return false;
+  if (msg.messageCount > count && count >= msg.startMsgCount) {
+    msg.tradingState.push_back(tradingStates[get2bytes(&buf[1])]);
+  }
+  return true;
+}
+
+#endif //MESSAGEFILTER_H
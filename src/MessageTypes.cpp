@@ -1,4 +1,7 @@
 #include "MessageTypes.h"
+#include <algorithm>
+#include "ArrowExport.h"
+#include "DataFrameBuilder.h"
 
 /**
  * @brief      Converts 2 bytes from a buffer in big endian to an unsigned integer
@@ -60,9 +63,11 @@ unsigned long long MessageType::countValidMessages(std::vector<unsigned long lon
 }
 
 // virtual functions of the class MessageType, will be overloaded by the other classes
-bool MessageType::loadMessages(unsigned char* buf) { return bool(); }
+bool MessageType::loadMessages(unsigned char*) { return bool(); }
 Rcpp::DataFrame MessageType::getDF() { return Rcpp::DataFrame(); }
-void MessageType::reserve(unsigned long long size) {}
+SEXP MessageType::getArrow() { Rcpp::stop("The messages cannot be exported to Arrow"); }
+void MessageType::reserve(unsigned long long) {}
+void MessageType::finish() {}
 
 
 /**
@@ -121,24 +126,13 @@ bool Orders::loadMessages(unsigned char* buf) {
   buy.push_back(            buf[19] == 'B' );
   shares.push_back(         get4bytes(&buf[20]) );
 
-  // 8 characters make up the stockname
-  std::string stock_string;
-  const unsigned char white = ' ';
-  for (unsigned int i = 0; i < 8U; ++i) {
-    if (buf[24 + i] != white) stock_string += buf[24 + i];
-  }
-  stock.push_back( stock_string );
+  // 8 characters make up the stockname, kept as one raw word (see getSymbolLength)
+  stock.push_back( get8bytes(&buf[24]) );
   
   price.push_back( (double) get4bytes(&buf[32]) / 10000.0 );
   
-  // 4 characters make up the MPID-string (if message type 'F')
-  std::string mpid_string = "";
-  if (buf[0] == 'F') { // type 'F' is an MPID order
-    for (unsigned int i = 0; i < 4U; ++i) {
-      if (buf[36 + i] != white) mpid_string += buf[36 + i];
-    }
-  }
-  mpid.push_back( mpid_string );
+  // 4 characters make up the MPID-string (if message type 'F', type 'F' is an MPID order)
+  mpid.push_back( buf[0] == 'F' ? get4bytes(&buf[36]) : 0U );
   
   // increase the number of this message type
   ++messageCount;
@@ -146,26 +140,47 @@ bool Orders::loadMessages(unsigned char* buf) {
 }
 
 /**
- * @brief      Converts the stored information into an Rcpp::DataFrame
+ * @brief      Adds the columns to a DataFrameBuilder or an ArrowBuilder
+ *
+ * @param      df    The builder
+ */
+template <typename Builder>
+void Orders::addColumns(Builder& df) {
+  df.addFactor( "msg_type",        type, validTypes);
+  df.addNumeric("locate_code",     locateCode);
+  df.addNumeric("tracking_number", trackingNumber);
+  df.addNumeric("timestamp",       timestamp);
+  df.addNumeric("order_ref",       orderRef);
+  df.addLogical("buy",             buy);
+  df.addNumeric("shares",          shares);
+  df.addSymbol( "stock",           stock);
+  df.addNumeric("price",           price);
+  df.addSymbol( "mpid",            mpid);
+  
+  if (tagTradingState) df.addFactor("trading_state", tradingState, ITCH::TRADING_STATES);
+}
+
+/**
+ * @brief      Converts the stored information into an Rcpp::DataFrame, 
+ *              the numeric columns are filled in parallel
  *
  * @return     The Rcpp::DataFrame
  */
 Rcpp::DataFrame Orders::getDF() {
+  DataFrameBuilder df(type.size());
+  addColumns(df);
+  return df.build();
+}
 
-  Rcpp::DataFrame df = Rcpp::DataFrame::create(
-    Rcpp::Named("msg_type")        = type,
-    Rcpp::Named("locate_code")     = locateCode,
-    Rcpp::Named("tracking_number") = trackingNumber,
-    Rcpp::Named("timestamp")       = timestamp,
-    Rcpp::Named("order_ref")       = orderRef,
-    Rcpp::Named("buy")             = buy,
-    Rcpp::Named("shares")          = shares,
-    Rcpp::Named("stock")           = stock,
-    Rcpp::Named("price")           = price,
-    Rcpp::Named("mpid")            = mpid
-  );
-  
-  return df;
+/**
+ * @brief      Moves the stored information into an Arrow stream (see ArrowBuilder)
+ *
+ * @return     An external pointer to the ArrowArrayStream
+ */
+SEXP Orders::getArrow() {
+  ArrowBuilder df(type.size());
+  addColumns(df);
+  return df.build();
 }
 
 /**
@@ -184,6 +199,7 @@ void Orders::reserve(unsigned long long size) {
   stock.reserve(size);
   price.reserve(size);
   mpid.reserve(size);
+  if (tagTradingState) tradingState.reserve(size);
 }
 
 
@@ -191,6 +207,19 @@ void Orders::reserve(unsigned long long size) {
 // ################################ Trades ########################################
 // ################################################################################
 
+/**
+ * @brief      Checks the use of the broken trades as passed from R
+ *
+ * @param[in]  brokenMode  The use of the broken trades, 0 keep, 1 flag, 2 drop
+ *
+ * @return     The BrokenTradeMode
+ */
+BrokenTradeMode checkBrokenMode(int brokenMode) {
+  if (brokenMode < BROKEN_KEEP || brokenMode > BROKEN_DROP)
+    Rcpp::stop("broken has to be one of 'keep', 'flag', or 'drop'");
+  return (BrokenTradeMode) brokenMode;
+}
+
 /**
  * @brief      Loads the information from an trades into the class, either of type 'P', 'Q', or 'B'
  *
@@ -226,9 +255,6 @@ bool Trades::loadMessages(unsigned char* buf) {
   locateCode.push_back(     get2bytes(&buf[1]) );
   trackingNumber.push_back( get2bytes(&buf[3]) );
   timestamp.push_back(      get6bytes(&buf[5]) );
-  
-  std::string stock_string;
-  const unsigned char white = ' ';
 
   switch (buf[0]) {
     case 'P':
@@ -237,10 +263,7 @@ bool Trades::loadMessages(unsigned char* buf) {
       shares.push_back(  get4bytes(&buf[20]) );
 
       // 8 characters make up the stockname
-      for (unsigned int i = 0; i < 8U; ++i) {
-        if (buf[24 + i] != white) stock_string += buf[24 + i];
-      }
-      stock.push_back(       stock_string );
+      stock.push_back(       get8bytes(&buf[24]) );
       price.push_back(       (double) get4bytes(&buf[32]) / 10000.0 );
       matchNumber.push_back( get8bytes(&buf[36]) );
       // empty assigns
@@ -249,11 +272,7 @@ bool Trades::loadMessages(unsigned char* buf) {
 
     case 'Q':
       shares.push_back(get4bytes(&buf[11]));
-
-      for (unsigned int i = 0; i < 8U; ++i) {
-        if (buf[19 + i] != white) stock_string += buf[19 + i];
-      }
-      stock.push_back(       stock_string );
+      stock.push_back(       get8bytes(&buf[19]) );
       price.push_back(       (double) get4bytes(&buf[27]) / 10000.0 ); // price = cross-price!
       matchNumber.push_back( get8bytes(&buf[31]) );
       crossType.push_back(   buf[39] );
@@ -268,7 +287,7 @@ bool Trades::loadMessages(unsigned char* buf) {
       orderRef.push_back(  0ULL );
       buy.push_back(       false );
       shares.push_back(    0ULL );
-      stock.push_back(     "" );
+      stock.push_back(     0ULL );
       price.push_back(     0.0 );
       crossType.push_back( ' ' );
       break;
@@ -279,33 +298,131 @@ bool Trades::loadMessages(unsigned char* buf) {
 
   }
 
+  // the trades are indexed by their match number, thus a broken trade is found in the same pass
+  if (brokenMode != BROKEN_KEEP) {
+    if (brokenMode == BROKEN_FLAG) broken.push_back(buf[0] == 'B');
+    if (buf[0] == 'B') {
+      breakTrade(type.size() - 1);
+    } else {
+      matchRows[matchNumber.back()] = type.size() - 1;
+    }
+  }
+
   // increase the number of this message type
   ++messageCount;
   return true;
 }
 
 /**
- * @brief      Converts the stored information into an Rcpp::DataFrame
+ * @brief      Flags or removes the trade of a broken trade message,
+ *              the message itself is removed unless its trade is unknown and the trades are flagged
+ *
+ * @param[in]  row   The row of the broken trade message
+ */
+void Trades::breakTrade(unsigned long long row) {
+  auto it = matchRows.find(matchNumber[row]);
+  if (it == matchRows.end()) {
+    // the trade is not loaded (i.e., an execution of an order or a trade before the start count)
+    if (brokenMode == BROKEN_DROP) removedRows.push_back(row);
+    return;
+  }
+
+  if (brokenMode == BROKEN_FLAG) {
+    broken[it->second] = true;
+  } else {
+    removedRows.push_back(it->second);
+  }
+  removedRows.push_back(row);
+  matchRows.erase(it);
+}
+
+/**
+ * @brief      Removes rows of a column, keeping the order of the other rows
+ *
+ * @param      x     The column
+ * @param[in]  rows  The rows to remove, sorted
+ */
+template <typename T, typename A>
+static void removeRows(std::vector<T, A>& x, std::vector<unsigned long long> const& rows) {
+  unsigned long long out = 0, r = 0;
+  for (unsigned long long i = 0; i < x.size(); ++i) {
+    if (r < rows.size() && rows[r] == i) {
+      ++r;
+      continue;
+    }
+    x[out++] = x[i];
+  }
+  x.resize(out);
+}
+
+/**
+ * @brief      Removes the rows of the broken trades and of the matched 'B' messages
+ */
+void Trades::removeBrokenRows() {
+  if (removedRows.empty()) return;
+  std::sort(removedRows.begin(), removedRows.end());
+  removeRows(type,           removedRows);
+  removeRows(locateCode,     removedRows);
+  removeRows(trackingNumber, removedRows);
+  removeRows(timestamp,      removedRows);
+  removeRows(orderRef,       removedRows);
+  removeRows(buy,            removedRows);
+  removeRows(shares,         removedRows);
+  removeRows(stock,          removedRows);
+  removeRows(price,          removedRows);
+  removeRows(matchNumber,    removedRows);
+  removeRows(crossType,      removedRows);
+  if (brokenMode == BROKEN_FLAG) removeRows(broken, removedRows);
+  if (tagTradingState) removeRows(tradingState, removedRows);
+  removedRows.clear();
+}
+
+/**
+ * @brief      Adds the columns to a DataFrameBuilder or an ArrowBuilder
+ *
+ * @param      df    The builder
+ */
+template <typename Builder>
+void Trades::addColumns(Builder& df) {
+  df.addFactor( "msg_type",        type, validTypes);
+  df.addNumeric("locate_code",     locateCode);
+  df.addNumeric("tracking_number", trackingNumber);
+  df.addNumeric("timestamp",       timestamp);
+  df.addNumeric("order_ref",       orderRef);
+  df.addLogical("buy",             buy);
+  df.addNumeric("shares",          shares);
+  df.addSymbol( "stock",           stock);
+  df.addNumeric("price",           price);
+  df.addNumeric("match_number",    matchNumber);
+  df.addFactor( "cross_type",      crossType, ITCH::CROSS_TYPES);
+  
+  if (brokenMode == BROKEN_FLAG) df.addLogical("broken", broken);
+  if (tagTradingState) df.addFactor("trading_state", tradingState, ITCH::TRADING_STATES);
+}
+
+/**
+ * @brief      Converts the stored information into an Rcpp::DataFrame, 
+ *              the numeric columns are filled in parallel
  *
  * @return     The Rcpp::DataFrame
  */
 Rcpp::DataFrame Trades::getDF() {
+  removeBrokenRows();
+  DataFrameBuilder df(type.size());
+  addColumns(df);
+  return df.build();
+}
 
-  Rcpp::DataFrame df = Rcpp::DataFrame::create(
-    Rcpp::Named("msg_type")        = type,
-    Rcpp::Named("locate_code")     = locateCode,
-    Rcpp::Named("tracking_number") = trackingNumber,
-    Rcpp::Named("timestamp")       = timestamp,
-    Rcpp::Named("order_ref")       = orderRef,
-    Rcpp::Named("buy")             = buy,
-    Rcpp::Named("shares")          = shares,
-    Rcpp::Named("stock")           = stock,
-    Rcpp::Named("price")           = price,
-    Rcpp::Named("match_number")    = matchNumber,
-    Rcpp::Named("cross_type")      = crossType
-  );
-  
-  return df;
+/**
+ * @brief      Moves the stored information into an Arrow stream (see ArrowBuilder)
+ *
+ * @return     An external pointer to the ArrowArrayStream
+ */
+SEXP Trades::getArrow() {
+  removeBrokenRows();
+  ArrowBuilder df(type.size());
+  addColumns(df);
+  return df.build();
 }
 
 /**
@@ -325,6 +442,9 @@ void Trades::reserve(unsigned long long size) {
   price.reserve(size);
   matchNumber.reserve(size);
   crossType.reserve(size);
+  if (brokenMode == BROKEN_FLAG) broken.reserve(size);
+  if (brokenMode != BROKEN_KEEP) matchRows.reserve(size);
+  if (tagTradingState) tradingState.reserve(size);
 }
 
 
@@ -374,7 +494,7 @@ bool Modifications::loadMessages(unsigned char* buf) {
       shares.push_back(      get4bytes(&buf[19]) ); // executed shares
       matchNumber.push_back( get8bytes(&buf[23]) );
       // empty assigns
-      printable.push_back(   'N' );
+      printable.push_back(   false );
       price.push_back(       0.0 );
       newOrderRef.push_back( 0ULL );
       break;
@@ -382,7 +502,7 @@ bool Modifications::loadMessages(unsigned char* buf) {
     case 'C':
       shares.push_back(      get4bytes(&buf[19]) ); // executed shares
       matchNumber.push_back( get8bytes(&buf[23]) );
-      printable.push_back(   buf[31] );
+      printable.push_back(   buf[31] == 'Y' );
       price.push_back(       (double) get4bytes(&buf[32]) / 10000.0 );
       // empty assigns
       newOrderRef.push_back( 0ULL );
@@ -428,26 +548,47 @@ bool Modifications::loadMessages(unsigned char* buf) {
 }
 
 /**
- * @brief      Converts the stored information into an Rcpp::DataFrame
+ * @brief      Adds the columns to a DataFrameBuilder or an ArrowBuilder
+ *
+ * @param      df    The builder
+ */
+template <typename Builder>
+void Modifications::addColumns(Builder& df) {
+  df.addFactor( "msg_type",        type, validTypes);
+  df.addNumeric("locate_code",     locateCode);
+  df.addNumeric("tracking_number", trackingNumber);
+  df.addNumeric("timestamp",       timestamp);
+  df.addNumeric("order_ref",       orderRef);
+  df.addNumeric("shares",          shares);
+  df.addNumeric("match_number",    matchNumber);
+  df.addLogical("printable",       printable);
+  df.addNumeric("price",           price);
+  df.addNumeric("new_order_ref",   newOrderRef);
+  
+  if (tagTradingState) df.addFactor("trading_state", tradingState, ITCH::TRADING_STATES);
+}
+
+/**
+ * @brief      Converts the stored information into an Rcpp::DataFrame, 
+ *              the numeric columns are filled in parallel
  *
  * @return     The Rcpp::DataFrame
  */
 Rcpp::DataFrame Modifications::getDF() {
+  DataFrameBuilder df(type.size());
+  addColumns(df);
+  return df.build();
+}
 
-  Rcpp::DataFrame df = Rcpp::DataFrame::create(
-    Rcpp::Named("msg_type")        = type,
-    Rcpp::Named("locate_code")     = locateCode,
-    Rcpp::Named("tracking_number") = trackingNumber,
-    Rcpp::Named("timestamp")       = timestamp,
-    Rcpp::Named("order_ref")       = orderRef,
-    Rcpp::Named("shares")          = shares,
-    Rcpp::Named("match_number")    = matchNumber,
-    Rcpp::Named("printable")       = printable,
-    Rcpp::Named("price")           = price,
-    Rcpp::Named("new_order_ref")   = newOrderRef
-  );
-  
-  return df;
+/**
+ * @brief      Moves the stored information into an Arrow stream (see ArrowBuilder)
+ *
+ * @return     An external pointer to the ArrowArrayStream
+ */
+SEXP Modifications::getArrow() {
+  ArrowBuilder df(type.size());
+  addColumns(df);
+  return df.build();
 }
 
 /**
@@ -466,4 +607,5 @@ void Modifications::reserve(unsigned long long size) {
   printable.reserve(size);
   price.reserve(size);
   newOrderRef.reserve(size);
+  if (tagTradingState) tradingState.reserve(size);
 }
@@ -2,18 +2,21 @@
 #define MESSAGES_H
 
 #include <Rcpp.h>
+#include <unordered_map>
 #include "Specifications.h"
+#include "Memory.h"
 // [[Rcpp::plugins("cpp11")]]
 
 /**
  * #################################################################
  * Classes that are able to parse the buffer into multiple vectors
  *  containing the information and that can convert the vectors
- *  to an Rcpp::DataFrame
+ *  to an Rcpp::DataFrame or an Arrow stream (see ArrowBuilder)
  * The classes are:
  *  - MessageType: A "template" class
  *  - Orders: For Messages 'A' and 'F' (addOrders + add Orders MPID)
- *  - Trades: For Trades 'P', 'Q', and 'B' (Trades, Cross-Trades, and Broken Trades)
+ *  - Trades: For Trades 'P', 'Q', and 'B' (Trades, Cross-Trades, and Broken Trades),
+ *     the broken trades can be flagged or removed while the trades are parsed
  *  
  * Also some getXBytes functions, that get X bytes (big endian)
  *  and convert them to unsigned int (or long long int if needed)
@@ -26,6 +29,41 @@ unsigned int get4bytes(unsigned char* buf);
 unsigned long long get6bytes(unsigned char* buf);
 unsigned long long get8bytes(unsigned char* buf);
 
+/**
+ * @brief      Returns the number of characters of a right-padded ITCH alpha field 
+ *              (i.e., stock or MPID), which is stored as a raw big endian word 
+ *              as returned by get8bytes or get4bytes.
+ *              The trailing spaces are found with a single xor and count-trailing-zeros
+ *
+ * @param[in]  key     The raw word, 0 is treated as an empty field
+ * @param[in]  nChars  The number of characters of the field (8 for stocks, 4 for MPIDs)
+ *
+ * @return     The number of characters without the trailing spaces
+ */
+inline unsigned int getSymbolLength(unsigned long long key, unsigned int nChars) {
+  const unsigned long long spaces = 0x2020202020202020ULL >> (64 - 8 * nChars);
+  const unsigned long long chars  = key ^ spaces;
+  if (key == 0ULL || chars == 0ULL) return 0;
+  return nChars - __builtin_ctzll(chars) / 8;
+}
+
+/**
+ * @brief      Writes the characters of a raw ITCH alpha field into a char array
+ *
+ * @param[in]  key     The raw word as returned by get8bytes or get4bytes
+ * @param[in]  nChars  The number of characters of the field (8 for stocks, 4 for MPIDs)
+ * @param      out     The output array, needs space for at least nChars characters
+ *
+ * @return     The number of characters without the trailing spaces
+ */
+inline unsigned int getSymbolChars(unsigned long long key, unsigned int nChars, char* out) {
+  const unsigned int len = getSymbolLength(key, nChars);
+  for (unsigned int i = 0; i < len; ++i) {
+    out[i] = (char) (key >> (8 * (nChars - 1 - i)));
+  }
+  return len;
+}
+
 // #################################################################
 
 class MessageType {
@@ -39,7 +77,9 @@ public:
   // Virtual Functions
   virtual bool loadMessages(unsigned char* buf);
   virtual Rcpp::DataFrame getDF();
+  virtual SEXP getArrow(); // an Arrow stream of the columns (see ArrowBuilder)
   virtual void reserve(unsigned long long size);
+  virtual void finish(); // called once all messages are passed to loadMessages
 
   // Members
   unsigned long long messageCount  = 0,
@@ -47,6 +87,9 @@ public:
                      endMsgCount   = std::numeric_limits<unsigned long long>::max();
   const std::vector<unsigned char> validTypes;
   const std::vector<int> typePositions;
+  // the trading state of the stock of each message, only filled if tagTradingState (see MessageFilter)
+  bool tagTradingState = false;
+  Column<char> tradingState;
 
 protected:
   explicit MessageType(std::vector<unsigned char> const& validTypes,
@@ -64,43 +107,69 @@ public:
   bool loadMessages(unsigned char* buf);
   void reserve(unsigned long long size);
   Rcpp::DataFrame getDF();
+  SEXP getArrow();
   
   // Members
-  std::vector<char> type;
-  std::vector<unsigned long long> locateCode;
-  std::vector<unsigned long long> trackingNumber;
-  std::vector<unsigned long long> timestamp;
-  std::vector<unsigned long long> orderRef;
-  std::vector<bool>               buy;
-  std::vector<unsigned long long> shares;
-  std::vector<std::string>        stock;
-  std::vector<double>             price;
-  std::vector<std::string>        mpid;
+  Column<char>               type;
+  Column<unsigned long long> locateCode;
+  Column<unsigned long long> trackingNumber;
+  Column<unsigned long long> timestamp;
+  Column<unsigned long long> orderRef;
+  Column<bool>               buy;
+  Column<unsigned long long> shares;
+  Column<unsigned long long> stock; // raw 8 characters
+  Column<double>             price;
+  Column<unsigned int>       mpid;  // raw 4 characters, 0 for 'A' orders
+
+private:
+  template <typename Builder>
+  void addColumns(Builder& df);
+};
+
+enum BrokenTradeMode {
+  BROKEN_KEEP = 0, // the broken trade messages ('B') are loaded as rows
+  BROKEN_FLAG = 1, // the broken trades are flagged (column broken), matched 'B' messages are removed
+  BROKEN_DROP = 2  // the broken trades and all 'B' messages are removed
 };
+BrokenTradeMode checkBrokenMode(int brokenMode);
 
 /**
- * @brief      A class that parses the trades (message type 'P', 'Q', and 'B')
+ * @brief      A class that parses the trades (message type 'P', 'Q', and 'B'),
+ *              the broken trades are found by their match number while the trades are parsed
  */
 class Trades : public MessageType {
 public:
-  Trades() : MessageType({'P', 'Q', 'B'}, {ITCH::POS::P, ITCH::POS::Q, ITCH::POS::B}) {}
+  explicit Trades(BrokenTradeMode brokenMode = BROKEN_KEEP) : 
+    MessageType({'P', 'Q', 'B'}, {ITCH::POS::P, ITCH::POS::Q, ITCH::POS::B}), brokenMode(brokenMode) {}
   // Functions
   bool loadMessages(unsigned char* buf);
   void reserve(unsigned long long size);
   Rcpp::DataFrame getDF();
+  SEXP getArrow();
   
   // Members
-  std::vector<char> type;
-  std::vector<unsigned long long> locateCode;
-  std::vector<unsigned long long> trackingNumber;
-  std::vector<unsigned long long> timestamp;
-  std::vector<unsigned long long> orderRef;
-  std::vector<bool>               buy;
-  std::vector<unsigned long long> shares;
-  std::vector<std::string>        stock;
-  std::vector<double>             price;
-  std::vector<unsigned long long> matchNumber;
-  std::vector<char>               crossType;
+  Column<char>               type;
+  Column<unsigned long long> locateCode;
+  Column<unsigned long long> trackingNumber;
+  Column<unsigned long long> timestamp;
+  Column<unsigned long long> orderRef;
+  Column<bool>               buy;
+  Column<unsigned long long> shares;
+  Column<unsigned long long> stock; // raw 8 characters
+  Column<double>             price;
+  Column<unsigned long long> matchNumber;
+  Column<char>               crossType;
+  Column<bool>               broken; // only if the broken trades are flagged
+
+private:
+  void breakTrade(unsigned long long row);
+  void removeBrokenRows();
+  template <typename Builder>
+  void addColumns(Builder& df);
+
+  BrokenTradeMode brokenMode;
+  std::unordered_map<unsigned long long, unsigned long long> matchRows; // the row of a match number
+  std::vector<unsigned long long> removedRows; // the rows that are removed in removeBrokenRows()
 };
 
 
@@ -115,18 +184,23 @@ public:
   bool loadMessages(unsigned char* buf);
   void reserve(unsigned long long size);
   Rcpp::DataFrame getDF();
+  SEXP getArrow();
   
   // Members
-  std::vector<char> type;
-  std::vector<unsigned long long> locateCode;
-  std::vector<unsigned long long> trackingNumber;
-  std::vector<unsigned long long> timestamp;
-  std::vector<unsigned long long> orderRef;
-  std::vector<unsigned long long> shares;
-  std::vector<unsigned long long> matchNumber;
-  std::vector<bool>               printable;
-  std::vector<double>             price;
-  std::vector<unsigned long long> newOrderRef;
+  Column<char>               type;
+  Column<unsigned long long> locateCode;
+  Column<unsigned long long> trackingNumber;
+  Column<unsigned long long> timestamp;
+  Column<unsigned long long> orderRef;
+  Column<unsigned long long> shares;
+  Column<unsigned long long> matchNumber;
+  Column<bool>               printable;
+  Column<double>             price;
+  Column<unsigned long long> newOrderRef;
+
+private:
+  template <typename Builder>
+  void addColumns(Builder& df);
 };
 
 #endif //MESSAGES_H
@@ -0,0 +1,233 @@
+#include "MidPrices.h"
+#include "BookSnapshot.h"
+#include <cmath>
+#include "DataFrameBuilder.h"
+#include "RITCH.h"
+#include "Session.h"
+
+/**
+ * @brief      Applies a message to the book and samples the mid price of its stock,
+ *              system events start and end the sampling of the market hours
+ *
+ * @param      buf   The buffer
+ */
+void MidPrices::onApply(unsigned char* buf) {
+  const unsigned long long ts = get6bytes(&buf[5]);
+  if (buf[0] == 'S') {
+    if (!regularOnly) return;
+    if (buf[11] == ITCH::EVENT::START_MARKET) {
+      // the grids start with the mid prices of the book at the open
+      sampling = true;
+      for (unsigned int locate = 0; locate < stocks.size(); ++locate) {
+        if (stocks[locate] != 0) observe(locate, ts);
+      }
+    } else if (buf[11] == ITCH::EVENT::END_MARKET && sampling) {
+      sampleAll();
+      sampling = false;
+    }
+    return;
+  }
+
+  book.update(buf);
+  if (sampling) observe(get2bytes(&buf[1]), ts);
+}
+
+/**
+ * @brief      Applies the pending modifications and takes the last samples
+ */
+void MidPrices::finish() {
+  flush();
+  if (sampling) sampleAll();
+}
+
+/**
+ * @brief      Observes the mid price of a stock on all grids, the grid intervals
+ *              that were left since the last observation are sampled first
+ *
+ * @param[in]  locate  The stock locate code
+ * @param[in]  ts      The timestamp of the observation
+ */
+void MidPrices::observe(unsigned int locate, unsigned long long ts) {
+  const TopOfBook quote = book.top(locate);
+  if (quote.bidPrice == 0 || quote.askPrice == 0) return;
+  const unsigned long long mid = (unsigned long long) quote.bidPrice + quote.askPrice;
+
+  const unsigned int nGrids = resolutions.size();
+  if (samplers.size() < (locate + 1ULL) * nGrids) samplers.resize((locate + 1ULL) * nGrids);
+  for (unsigned int grid = 0; grid < nGrids; ++grid) {
+    Sampler& s = samplers[locate * nGrids + grid];
+    const long long bucket = ts / resolutions[grid];
+    if (s.bucket >= 0 && bucket != s.bucket) sample(locate, grid);
+    s.bucket = bucket;
+    s.mid    = mid;
+  }
+}
+
+/**
+ * @brief      Samples the last mid price of the current grid interval of a stock
+ *              at the end of the interval, unless it did not change since the last sample
+ *
+ * @param[in]  locate  The stock locate code
+ * @param[in]  grid    The index of the grid
+ */
+void MidPrices::sample(unsigned int locate, unsigned int grid) {
+  Sampler& s = samplers[locate * resolutions.size() + grid];
+  if (s.bucket < 0 || s.mid == s.sampled) return;
+
+  double ret = NA_REAL;
+  if (s.sampled == 0) {
+    s.firstBucket = s.bucket;
+  } else {
+    ret = std::log((double) s.mid / (double) s.sampled);
+    s.variance += ret * ret;
+    ++s.changes;
+  }
+  s.lastBucket = s.bucket;
+  s.sampled    = s.mid;
+
+  locateCode.push_back( locate );
+  stock.push_back(      locate < stocks.size() ? stocks[locate] : 0ULL );
+  resolution.push_back( (double) resolutions[grid] / 1e9 );
+  timestamp.push_back(  (s.bucket + 1) * resolutions[grid] );
+  midPrice.push_back(   (double) s.mid / 20000.0 );
+  logReturn.push_back(  ret );
+}
+
+/**
+ * @brief      Samples the current grid intervals of all stocks
+ */
+void MidPrices::sampleAll() {
+  const unsigned int nGrids = resolutions.size();
+  for (unsigned int locate = 0; locate * nGrids < samplers.size(); ++locate) {
+    for (unsigned int grid = 0; grid < nGrids; ++grid) sample(locate, grid);
+  }
+}
+
+/**
+ * @brief      Converts the samples into an Rcpp::DataFrame,
+ *              the numeric columns are filled in parallel
+ *
+ * @return     The Rcpp::DataFrame
+ */
+Rcpp::DataFrame MidPrices::getDF() {
+
+  DataFrameBuilder df(locateCode.size());
+  df.addNumeric("locate_code", locateCode);
+  df.addSymbol( "stock",       stock);
+  df.addNumeric("resolution",  resolution);
+  df.addNumeric("timestamp",   timestamp);
+  df.addNumeric("mid_price",   midPrice);
+  df.addNumeric("log_return",  logReturn);
+
+  return df.build();
+}
+
+/**
+ * @brief      Returns the realized variance of each stock and grid
+ *
+ * @return     The Rcpp::DataFrame with one row per stock and grid that has a sample
+ */
+Rcpp::DataFrame MidPrices::getSummaryDF() {
+  const unsigned int nGrids = resolutions.size();
+  Column<unsigned long long> sLocate, sStock, sReturns, sChanges, sFirst, sLast;
+  Column<double> sResolution, sLastMid, sVariance;
+
+  for (unsigned long long i = 0; i < samplers.size(); ++i) {
+    Sampler const& s = samplers[i];
+    if (s.sampled == 0) continue;
+    const unsigned int locate = i / nGrids;
+    const unsigned long long res = resolutions[i % nGrids];
+    sLocate.push_back(     locate );
+    sStock.push_back(      locate < stocks.size() ? stocks[locate] : 0ULL );
+    sResolution.push_back( (double) res / 1e9 );
+    sFirst.push_back(      (s.firstBucket + 1) * res );
+    sLast.push_back(       (s.lastBucket + 1) * res );
+    sReturns.push_back(    s.lastBucket - s.firstBucket );
+    sChanges.push_back(    s.changes );
+    sLastMid.push_back(    (double) s.sampled / 20000.0 );
+    sVariance.push_back(   s.variance );
+  }
+
+  DataFrameBuilder df(sLocate.size());
+  df.addNumeric("locate_code",       sLocate);
+  df.addSymbol( "stock",             sStock);
+  df.addNumeric("resolution",        sResolution);
+  df.addNumeric("first_timestamp",   sFirst);
+  df.addNumeric("last_timestamp",    sLast);
+  df.addNumeric("n_returns",         sReturns);
+  df.addNumeric("n_changes",         sChanges);
+  df.addNumeric("last_mid_price",    sLastMid);
+  df.addNumeric("realized_variance", sVariance);
+
+  return df.build();
+}
+
+
+// @brief      Returns the mid price samples of a file on several grids and the
+//              realized variance of each stock and grid
+//
+// @param[in]  filename     The filename to a plain-text-file, "-" for stdin, or "| cmd"
+// @param[in]  bufferSize   The buffer size in bytes, 0 chooses the size automatically
+// @param[in]  resolutions  The resolutions of the grids in nanoseconds
+// @param[in]  regularOnly  If true, only the market hours are sampled
+// @param[in]  stockLocate  The stock locate codes to load, empty for all stocks
+// @param[in]  bookFile     The book file whose last snapshot seeds the book, empty for an empty book
+// @param[in]  quiet        If true, no status message is printed
+//
+// @return     A list of the samples and the realized variances (data.frames)
+//
+// [[Rcpp::export]]
+Rcpp::List getMidPrices_impl(std::string filename,
+                             unsigned long long bufferSize,
+                             std::vector<double> resolutions,
+                             bool regularOnly,
+                             Rcpp::IntegerVector stockLocate,
+                             std::string bookFile,
+                             bool quiet) {
+  MidPrices mids(std::vector<unsigned long long>(resolutions.begin(), resolutions.end()), regularOnly);
+  if (!bookFile.empty()) mids.seed(readLastSnapshot(bookFile));
+
+  // the system events have no stock (locate code 0)
+  if (stockLocate.size() > 0) stockLocate.push_back(0);
+
+  mids.replayFile(filename, bufferSize, quiet, MessageFilter::create(stockLocate, MARKET_ALL, TRADING_KEEP));
+
+  if (!quiet) Rcpp::Rcout << "\n[Converting] to data.table\n";
+  return Rcpp::List::create(
+    Rcpp::Named("mid_prices")        = mids.getDF(),
+    Rcpp::Named("realized_variance") = mids.getSummaryDF()
+  );
+}
+
+// @brief      Returns the mid price samples of a session on several grids and the
+//              realized variance of each stock and grid
+//
+// @param[in]  session      The external pointer to the session
+// @param[in]  resolutions  The resolutions of the grids in nanoseconds
+// @param[in]  regularOnly  If true, only the market hours are sampled
+// @param[in]  stockLocate  The stock locate codes to load, empty for all stocks
+// @param[in]  bookFile     The book file whose last snapshot seeds the book, empty for an empty book
+// @param[in]  quiet        If true, no status message is printed
+//
+// @return     A list of the samples and the realized variances (data.frames)
+//
+// [[Rcpp::export]]
+Rcpp::List getSessionMidPrices_impl(SEXP session,
+                                    std::vector<double> resolutions,
+                                    bool regularOnly,
+                                    Rcpp::IntegerVector stockLocate,
+                                    std::string bookFile,
+                                    bool quiet) {
+  MidPrices mids(std::vector<unsigned long long>(resolutions.begin(), resolutions.end()), regularOnly);
+  if (!bookFile.empty()) mids.seed(readLastSnapshot(bookFile));
+
+  // the system events have no stock (locate code 0)
+  if (stockLocate.size() > 0) stockLocate.push_back(0);
+
+  Rcpp::RObject samples = getSessionMessagesTemplate(mids, session, 0, 0, stockLocate,
+                                                     MARKET_ALL, TRADING_KEEP, quiet);
+  return Rcpp::List::create(
+    Rcpp::Named("mid_prices")        = samples,
+    Rcpp::Named("realized_variance") = mids.getSummaryDF()
+  );
+}
@@ -0,0 +1,74 @@
+#ifndef MIDPRICES_H
+#define MIDPRICES_H
+
+#include <Rcpp.h>
+#include <vector>
+#include "BookReplay.h"
+#include "OrderBook.h"
+#include "Specifications.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * MidPrices replays the order book (see OrderBook) and samples the mid price
+ *  of each stock on several time grids at once (i.e., 1 second, 5 seconds,
+ *  and 1 minute), thus the quotes are never materialised.
+ *
+ * The sample of a grid point is the last mid price before it (previous tick
+ *  sampling), a mid price needs both sides of the book. Only the grid points
+ *  at which the mid price changed are written, the log returns of the other
+ *  grid points are 0, thus the realized variance (the sum of the squared
+ *  log returns) of each stock and grid is kept while the samples are written.
+ *
+ * If only the market hours are sampled, the grids start with the mid prices
+ *  at the start of market hours (the book is replayed from the start of the file)
+ *  and the last samples are taken at the end of market hours, both are taken
+ *  from the system event messages ('S').
+ * #################################################################
+ */
+
+class MidPrices : public BookReplay {
+public:
+  MidPrices(std::vector<unsigned long long> const& resolutions, bool regularOnly) :
+    BookReplay({'S', 'A', 'F', 'E', 'C', 'X', 'D', 'U'},
+      {ITCH::POS::S, ITCH::POS::A, ITCH::POS::F, ITCH::POS::E,
+       ITCH::POS::C, ITCH::POS::X, ITCH::POS::D, ITCH::POS::U}),
+    resolutions(resolutions), sampling(!regularOnly), regularOnly(regularOnly) {}
+  // Functions
+  void reserve(unsigned long long) {} // few messages change a mid price, the columns grow as needed
+  Rcpp::DataFrame getDF();
+  Rcpp::DataFrame getSummaryDF();
+  void finish();
+
+  // Members, the samples
+  Column<unsigned long long> locateCode;
+  Column<unsigned long long> stock; // raw 8 characters
+  Column<double>             resolution; // in seconds
+  Column<unsigned long long> timestamp;  // the grid point
+  Column<double>             midPrice;
+  Column<double>             logReturn;  // NA for the first sample
+
+private:
+  // the sampling of one stock on one grid, the mid prices are the sum of bid and ask
+  struct Sampler {
+    long long          bucket  = -1; // the grid interval of the last mid price, -1 before the first
+    unsigned long long mid     = 0;  // the last mid price of the interval
+    unsigned long long sampled = 0;  // the mid price of the last sample, 0 before the first sample
+    unsigned long long firstBucket = 0;
+    unsigned long long lastBucket  = 0;
+    unsigned long long changes     = 0;
+    double             variance    = 0;
+  };
+
+  void onApply(unsigned char* buf);
+  void observe(unsigned int locate, unsigned long long ts);
+  void sample(unsigned int locate, unsigned int grid);
+  void sampleAll();
+
+  std::vector<unsigned long long> resolutions; // in nanoseconds
+  bool sampling;
+  bool regularOnly;
+  std::vector<Sampler> samplers; // by locate code and grid
+};
+
+#endif //MIDPRICES_H
@@ -0,0 +1,131 @@
+#include "Numa.h"
+#include <cstdio>
+#include <string>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+ * @brief      Parses a cpulist or a node list as found in sysfs (i.e., "0-3,8-11")
+ *
+ * @param[in]  list  The cpulist
+ *
+ * @return     The ids
+ */
+static std::vector<int> parseCPUList(const std::string& list) {
+  std::vector<int> cpus;
+  unsigned long long pos = 0;
+  while (pos < list.size()) {
+    int from, to, n = 0;
+    if (sscanf(list.c_str() + pos, "%d-%d%n", &from, &to, &n) == 2 && n > 0) {
+      for (int cpu = from; cpu <= to; ++cpu) cpus.push_back(cpu);
+    } else if (sscanf(list.c_str() + pos, "%d%n", &from, &n) == 1 && n > 0) {
+      cpus.push_back(from);
+    } else {
+      break;
+    }
+    pos += n + 1; // skip the comma
+  }
+  return cpus;
+}
+
+/**
+ * @brief      Reads a line of a sysfs file
+ *
+ * @param[in]  path  The path of the file
+ * @param      line  The line (without the newline)
+ *
+ * @return     false if the file cannot be read
+ */
+static bool readLine(const std::string& path, std::string& line) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (file == NULL) return false;
+  char buf[4096];
+  line = fgets(buf, sizeof(buf), file) != NULL ? buf : "";
+  fclose(file);
+  return true;
+}
+
+/**
+ * @brief      Reads the topology: the online nodes (their ids may have gaps) and their CPUs
+ *
+ * @return     The nodes, a single node 0 (without CPUs) if the topology is unknown
+ */
+static std::vector<NumaNode> readTopology() {
+  std::vector<NumaNode> topology;
+#ifdef __linux__
+  std::string online;
+  if (readLine("/sys/devices/system/node/online", online)) {
+    for (int node : parseCPUList(online)) {
+      std::string list;
+      if (!readLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist", list)) continue;
+      topology.push_back(NumaNode{node, parseCPUList(list)});
+    }
+  }
+#endif
+  if (topology.empty()) topology.push_back(NumaNode{0, std::vector<int>()});
+  return topology;
+}
+
+/**
+ * @brief      Returns the topology, which is read once. The worker threads call this
+ *              concurrently when they start, the static is initialized thread-safe
+ *
+ * @return     The nodes
+ */
+static const std::vector<NumaNode>& getTopology() {
+  static const std::vector<NumaNode> topology = readTopology();
+  return topology;
+}
+
+/**
+ * @brief      Returns the ids of the online NUMA nodes
+ *
+ * @return     The node ids (at least one)
+ */
+std::vector<int> getNumaNodes() {
+  std::vector<int> ids;
+  for (NumaNode const& node : getTopology()) ids.push_back(node.id);
+  return ids;
+}
+
+/**
+ * @brief      Returns the node of a CPU
+ *
+ * @param[in]  cpu   The CPU id
+ *
+ * @return     The node id, 0 if unknown
+ */
+int getNumaNode(int cpu) {
+  for (NumaNode const& node : getTopology()) {
+    for (int c : node.cpus) if (c == cpu) return node.id;
+  }
+  return 0;
+}
+
+/**
+ * @brief      Returns the CPUs of a node
+ *
+ * @param[in]  node  The node id
+ *
+ * @return     The CPU ids, empty if unknown
+ */
+std::vector<int> getNumaCPUs(int node) {
+  for (NumaNode const& n : getTopology()) {
+    if (n.id == node) return n.cpus;
+  }
+  return std::vector<int>();
+}
+
+/**
+ * @brief      Returns the CPU the calling thread currently runs on
+ *
+ * @return     The CPU id, -1 if unknown
+ */
+int getCurrentCPU() {
+#ifdef __linux__
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
@@ -0,0 +1,27 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <vector>
+
+/**
+ * #################################################################
+ * The NUMA topology of the machine as found in /sys/devices/system/node
+ *  (Linux only, other systems are treated as a single node).
+ *
+ * The ThreadPool uses it to spread pinned workers over the nodes,
+ *  the memory that a worker touches first is then placed on its local node
+ * #################################################################
+ */
+
+// a NUMA node and its CPUs
+struct NumaNode {
+  int id;
+  std::vector<int> cpus;
+};
+
+std::vector<int> getNumaNodes();
+int getNumaNode(int cpu);
+std::vector<int> getNumaCPUs(int node);
+int getCurrentCPU();
+
+#endif //NUMA_H
@@ -0,0 +1,483 @@
+#include "OrderBook.h"
+#include <algorithm>
+#include <cstring>
+#include "RITCH.h"
+
+/**
+ * @brief      Applies a message to the book, messages that do not change the book are ignored
+ *
+ * @param      buf   The buffer, starting at the message type
+ */
+void OrderBook::update(unsigned char* buf) {
+  switch (buf[0]) {
+  case 'A':
+  case 'F':
+    add(get8bytes(&buf[11]), get2bytes(&buf[1]), buf[19] == 'B', get4bytes(&buf[32]), get4bytes(&buf[20]));
+    break;
+  case 'E':
+  case 'C':
+  case 'X':
+    reduce(get8bytes(&buf[11]), get4bytes(&buf[19]));
+    break;
+  case 'D':
+    remove(get8bytes(&buf[11]));
+    break;
+  case 'U':
+    replace(get8bytes(&buf[11]), get8bytes(&buf[19]), get4bytes(&buf[27]), get4bytes(&buf[31]));
+    break;
+  }
+}
+
+/**
+ * @brief      Adds an order to the book, at the end of the queue of its price level
+ *
+ * @param[in]  orderRef    The order reference number
+ * @param[in]  locateCode  The stock locate code
+ * @param[in]  buy         True for a bid, false for an ask
+ * @param[in]  price       The price in 1e-4 dollars
+ * @param[in]  shares      The number of shares
+ */
+void OrderBook::add(unsigned long long orderRef, unsigned int locateCode, bool buy,
+                    unsigned int price, unsigned long long shares) {
+  // a reused order reference replaces the old order
+  const unsigned int old = index.find(orderRef);
+  if (old != NO_ORDER) remove(orderRef, old);
+
+  const unsigned int idx = pool.allocate();
+  BookOrder& order = pool[idx];
+  order = BookOrder{locateCode, buy, price, shares, NO_ORDER, NO_ORDER};
+  index.insert(orderRef, idx);
+  getSide(order).insert(pool, idx);
+}
+
+/**
+ * @brief      Removes shares from an order (execution or cancellation),
+ *              the order is removed once no shares are left
+ *
+ * @param[in]  orderRef  The order reference number
+ * @param[in]  shares    The number of shares, at most the remaining shares are removed
+ *
+ * @return     false if the order is unknown
+ */
+bool OrderBook::reduce(unsigned long long orderRef, unsigned long long shares) {
+  const unsigned int idx = index.find(orderRef);
+  if (idx == NO_ORDER) return false;
+
+  BookOrder& order = pool[idx];
+  if (shares >= order.shares) {
+    remove(orderRef, idx);
+  } else {
+    // the order keeps its place in the queue
+    getSide(order).reduce(order.price, shares);
+    order.shares -= shares;
+  }
+  return true;
+}
+
+/**
+ * @brief      Removes an order from the book
+ *
+ * @param[in]  orderRef  The order reference number
+ *
+ * @return     false if the order is unknown
+ */
+bool OrderBook::remove(unsigned long long orderRef) {
+  const unsigned int idx = index.find(orderRef);
+  if (idx == NO_ORDER) return false;
+
+  remove(orderRef, idx);
+  return true;
+}
+
+/**
+ * @brief      Removes an order from the queue of its level, the index, and the pool
+ *
+ * @param[in]  orderRef  The order reference number
+ * @param[in]  idx       The index of the order in the pool
+ */
+void OrderBook::remove(unsigned long long orderRef, unsigned int idx) {
+  getSide(pool[idx]).erase(pool, idx);
+  index.erase(orderRef);
+  pool.release(idx);
+}
+
+/**
+ * @brief      Replaces an order, the new order keeps the stock and the side
+ *              and is added at the end of the queue of its price level
+ *
+ * @param[in]  orderRef     The original order reference number
+ * @param[in]  newOrderRef  The new order reference number
+ * @param[in]  shares       The shares of the new order
+ * @param[in]  price        The price of the new order in 1e-4 dollars
+ *
+ * @return     false if the original order is unknown
+ */
+bool OrderBook::replace(unsigned long long orderRef, unsigned long long newOrderRef,
+                        unsigned long long shares, unsigned int price) {
+  const unsigned int idx = index.find(orderRef);
+  if (idx == NO_ORDER) return false;
+
+  const unsigned int locateCode = pool[idx].locateCode;
+  const bool buy = pool[idx].buy;
+  remove(orderRef, idx);
+  add(newOrderRef, locateCode, buy, price, shares);
+  return true;
+}
+
+/**
+ * @brief      Returns an order of the book
+ *
+ * @param[in]  orderRef  The order reference number
+ *
+ * @return     The order, NULL if it is not in the book, valid until the book is changed
+ */
+const BookOrder* OrderBook::find(unsigned long long orderRef) const {
+  const unsigned int idx = index.find(orderRef);
+  return idx == NO_ORDER ? NULL : &pool[idx];
+}
+
+/**
+ * @brief      Prefetches the node of an order, its index slot should be prefetched before
+ *
+ * @param[in]  orderRef  The order reference number
+ */
+void OrderBook::prefetchOrder(unsigned long long orderRef) const {
+  const unsigned int idx = index.find(orderRef);
+  if (idx != NO_ORDER) __builtin_prefetch(&pool[idx]);
+}
+
+/**
+ * @brief      Returns the best bid and ask of a stock
+ *
+ * @param[in]  locateCode  The stock locate code
+ *
+ * @return     The top of book, the price of an empty side is 0
+ */
+TopOfBook OrderBook::top(unsigned int locateCode) const {
+  TopOfBook res;
+  if (locateCode >= books.size()) return res;
+
+  const Book& book = books[locateCode];
+  book.bids.best(res.bidPrice, res.bidShares);
+  book.asks.best(res.askPrice, res.askShares);
+  return res;
+}
+
+/**
+ * @brief      Returns the book of a stock, the books are grown on first use
+ *
+ * @param[in]  locateCode  The stock locate code
+ *
+ * @return     The book
+ */
+OrderBook::Book& OrderBook::getBook(unsigned int locateCode) {
+  if (locateCode >= books.size()) books.resize(locateCode + 1);
+  return books[locateCode];
+}
+
+// ################################################################################
+// ############################ ORDER POOL AND INDEX ##############################
+// ################################################################################
+
+/**
+ * @brief      Returns a free slot of the pool, released slots are reused first
+ *
+ * @return     The index of the slot
+ */
+unsigned int OrderPool::allocate() {
+  if (freeList != NO_ORDER) {
+    const unsigned int idx = freeList;
+    freeList = nodes[idx].next;
+    return idx;
+  }
+  if (nodes.size() >= NO_ORDER) Rcpp::stop("Too many orders in the book");
+  nodes.push_back(BookOrder());
+  return nodes.size() - 1;
+}
+
+/**
+ * @brief      Releases a slot of the pool
+ *
+ * @param[in]  idx   The index of the slot
+ */
+void OrderPool::release(unsigned int idx) {
+  nodes[idx].next = freeList;
+  freeList = idx;
+}
+
+/**
+ * @brief      Returns the index of an order
+ *
+ * @param[in]  orderRef  The order reference number
+ *
+ * @return     The index in the pool, NO_ORDER if the order is unknown
+ */
+unsigned int OrderIndex::find(unsigned long long orderRef) const {
+  for (unsigned long long i = slot(orderRef); slots[i].orderRef != EMPTY; i = (i + 1) & mask) {
+    if (slots[i].orderRef == orderRef) return slots[i].idx;
+  }
+  return NO_ORDER;
+}
+
+/**
+ * @brief      Inserts (or updates) the index of an order, 
+ *              the table is doubled once it is half full
+ *
+ * @param[in]  orderRef  The order reference number
+ * @param[in]  idx       The index in the pool
+ */
+void OrderIndex::insert(unsigned long long orderRef, unsigned int idx) {
+  if (2 * (count + 1) > slots.size()) rehash(2 * slots.size());
+
+  unsigned long long i = slot(orderRef);
+  while (slots[i].orderRef != EMPTY && slots[i].orderRef != orderRef) i = (i + 1) & mask;
+  if (slots[i].orderRef == EMPTY) ++count;
+  slots[i].orderRef = orderRef;
+  slots[i].idx      = idx;
+}
+
+/**
+ * @brief      Removes an order, the following slots of the probe sequence
+ *              are shifted back (no tombstones)
+ *
+ * @param[in]  orderRef  The order reference number
+ */
+void OrderIndex::erase(unsigned long long orderRef) {
+  unsigned long long i = slot(orderRef);
+  while (slots[i].orderRef != orderRef) {
+    if (slots[i].orderRef == EMPTY) return;
+    i = (i + 1) & mask;
+  }
+
+  unsigned long long j = i;
+  while (true) {
+    j = (j + 1) & mask;
+    if (slots[j].orderRef == EMPTY) break;
+    // the entry stays if its home slot lies cyclically in (i, j]
+    const unsigned long long home = slot(slots[j].orderRef);
+    if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue;
+    slots[i] = slots[j];
+    i = j;
+  }
+  slots[i].orderRef = EMPTY;
+  --count;
+}
+
+/**
+ * @brief      Resizes the table and reinserts all orders
+ *
+ * @param[in]  size  The new number of slots, a power of two
+ */
+void OrderIndex::rehash(unsigned long long size) {
+  Column<Slot> old;
+  old.swap(slots);
+  slots.assign(size, Slot{EMPTY, 0});
+  mask  = size - 1;
+  shift = 64 - __builtin_ctzll(size);
+  count = 0;
+  for (Slot const& s : old) {
+    if (s.orderRef != EMPTY) insert(s.orderRef, s.idx);
+  }
+}
+
+/**
+ * @brief      Copies a modification into the batch and prefetches the index slot of its order
+ *
+ * @param[in]  book  The book
+ * @param      buf   The buffer, starting at the message type
+ *
+ * @return     true if the batch is full and has to be applied
+ */
+bool ModificationBatch::add(OrderBook const& book, unsigned char* buf) {
+  // the order reference follows the timestamp in all modifications
+  book.prefetch(get8bytes(&buf[11]));
+  memcpy(messages[count], buf, getMessageLength(buf[0]));
+  return ++count == BATCH_SIZE;
+}
+
+// ################################################################################
+// ############################### PRICE LADDER ###################################
+// ################################################################################
+
+/**
+ * @brief      Adds an order at the end of the queue of its price level
+ *
+ * @param      pool  The pool of the orders
+ * @param[in]  idx   The index of the order in the pool
+ */
+void PriceLadder::insert(OrderPool& pool, unsigned int idx) {
+  BookOrder& order = pool[idx];
+  const unsigned int price = order.price;
+
+  // the first price decides the tick size, cents from one dollar on
+  if (tick == 0) {
+    tick = price >= 10000 ? 100 : 1;
+    levels.assign(LADDER_SIZE, PriceLevel());
+    recenter(price);
+  }
+
+  long long li = index(price);
+  // the touch moved out of the ladder, the ladder follows it
+  if (li < 0 && price % tick == anchor % tick &&
+      (bestIdx < 0 || better(price, levelPrice(bestIdx)))) {
+    recenter(price);
+    li = index(price);
+  }
+
+  PriceLevel& level = getLevel(price, li);
+  order.prev = level.tail;
+  order.next = NO_ORDER;
+  if (level.tail != NO_ORDER) {
+    pool[level.tail].next = idx;
+  } else {
+    level.head = idx;
+  }
+  level.tail    = idx;
+  level.shares += order.shares;
+
+  if (li >= 0 && (bestIdx < 0 || better(price, levelPrice(bestIdx)))) bestIdx = li;
+}
+
+/**
+ * @brief      Removes an order from the queue of its price level, empty levels are removed
+ *
+ * @param      pool  The pool of the orders
+ * @param[in]  idx   The index of the order in the pool
+ */
+void PriceLadder::erase(OrderPool& pool, unsigned int idx) {
+  BookOrder& order = pool[idx];
+  const long long li = index(order.price);
+  PriceLevel& level = getLevel(order.price, li);
+
+  if (order.prev != NO_ORDER) {
+    pool[order.prev].next = order.next;
+  } else {
+    level.head = order.next;
+  }
+  if (order.next != NO_ORDER) {
+    pool[order.next].prev = order.prev;
+  } else {
+    level.tail = order.prev;
+  }
+  level.shares -= order.shares;
+
+  if (level.head == NO_ORDER) removeLevel(order.price, li);
+}
+
+/**
+ * @brief      Removes shares of a level, the orders keep their place in the queue
+ *
+ * @param[in]  price   The price in 1e-4 dollars
+ * @param[in]  shares  The number of shares
+ */
+void PriceLadder::reduce(unsigned int price, unsigned long long shares) {
+  getLevel(price, index(price)).shares -= shares;
+}
+
+/**
+ * @brief      Returns the best level
+ *
+ * @param      price   The best price, unchanged if the side is empty
+ * @param      shares  The shares of the best price, unchanged if the side is empty
+ *
+ * @return     false if the side is empty
+ */
+bool PriceLadder::best(unsigned int& price, unsigned long long& shares) const {
+  bool found = false;
+  if (bestIdx >= 0) {
+    price  = levelPrice(bestIdx);
+    shares = levels[bestIdx].shares;
+    found  = true;
+  }
+  // prices between the ticks or left behind by the ladder can be better
+  if (!far.empty()) {
+    auto it = bids ? std::prev(far.end()) : far.begin();
+    if (!found || better(it->first, price)) {
+      price  = it->first;
+      shares = it->second.shares;
+      found  = true;
+    }
+  }
+  return found;
+}
+
+/**
+ * @brief      Returns the index of a price in the ladder
+ *
+ * @param[in]  price  The price in 1e-4 dollars
+ *
+ * @return     The index, -1 if the price is outside of the ladder or between two ticks
+ */
+long long PriceLadder::index(unsigned int price) const {
+  if (price < anchor) return -1;
+  const unsigned int offset = price - anchor;
+  if (offset % tick != 0) return -1;
+  const long long idx = offset / tick;
+  return idx < LADDER_SIZE ? idx : -1;
+}
+
+/**
+ * @brief      Removes an empty level
+ *
+ * @param[in]  price  The price in 1e-4 dollars
+ * @param[in]  li     The index of the level in the ladder, -1 for a far price
+ */
+void PriceLadder::removeLevel(unsigned int price, long long li) {
+  if (li < 0) {
+    far.erase(price);
+    return;
+  }
+  levels[li] = PriceLevel();
+  if (li == bestIdx) findBest(li);
+}
+
+/**
+ * @brief      Finds the best level after the best level was emptied,
+ *              the search continues from the old best level to the worse prices
+ *
+ * @param[in]  from  The index of the old best level
+ */
+void PriceLadder::findBest(long long from) {
+  const long long step = bids ? -1 : 1;
+  for (long long i = from; i >= 0 && i < LADDER_SIZE; i += step) {
+    if (levels[i].head != NO_ORDER) {
+      bestIdx = i;
+      return;
+    }
+  }
+  bestIdx = -1;
+}
+
+/**
+ * @brief      Moves the ladder such that a price is in its middle,
+ *              the levels (with their queues) are moved between the ladder and the map of far prices
+ *
+ * @param[in]  price  The new center price
+ */
+void PriceLadder::recenter(unsigned int price) {
+  // the levels of the old ladder are moved to the far prices
+  if (bestIdx >= 0) {
+    for (long long i = 0; i < LADDER_SIZE; ++i) {
+      if (levels[i].head != NO_ORDER) far[levelPrice(i)] = levels[i];
+      levels[i] = PriceLevel();
+    }
+  }
+  bestIdx = -1;
+
+  const unsigned int half = (LADDER_SIZE / 2) * tick;
+  anchor = price >= half ? price - half : price % tick;
+
+  // the far prices on the ticks of the new ladder are moved into it
+  auto it = far.lower_bound(anchor);
+  const unsigned long long end = (unsigned long long) anchor + LADDER_SIZE * tick;
+  while (it != far.end() && it->first < end) {
+    const long long idx = index(it->first);
+    if (idx < 0) {
+      ++it;
+      continue;
+    }
+    levels[idx] = it->second;
+    if (bestIdx < 0 || better(it->first, levelPrice(bestIdx))) bestIdx = idx;
+    it = far.erase(it);
+  }
+}
@@ -0,0 +1,276 @@
+#ifndef ORDERBOOK_H
+#define ORDERBOOK_H
+
+#include <Rcpp.h>
+#include <vector>
+#include <map>
+#include <iterator>
+#include "MessageTypes.h"
+#include "Specifications.h"
+#include "Memory.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * OrderBook replays the displayed orders of all stocks of a venue
+ *  ('A', 'F', 'E', 'C', 'X', 'D', and 'U') and answers top of book queries.
+ *
+ * The prices are kept as the integer ITCH prices (1e-4 dollars, as returned
+ *  by get4bytes), the books are indexed by the stock locate code.
+ *  Orders that were added before the replayed messages are unknown,
+ *  their modifications are ignored.
+ *
+ * Each side of a book is a PriceLadder: a contiguous array of levels indexed
+ *  by the tick offset from an anchor price around the touch, thus updates
+ *  and top of book queries are array operations. Prices far from the touch
+ *  (or between the ticks) are kept in a map, the ladder is moved once the
+ *  touch leaves it.
+ *
+ * The orders are nodes of an OrderPool (a slab of orders that reuses the
+ *  slots of removed orders), each price level links its orders into a FIFO
+ *  queue by their indices. The OrderIndex finds the node of an order reference
+ *  (open addressing), thus executions and cancellations neither allocate nor search.
+ *
+ * Modifications are mostly cache misses in the index and the pool, a
+ *  ModificationBatch collects consecutive modifications and prefetches their
+ *  slots before they are applied in order.
+ * #################################################################
+ */
+
+// the index of no order (the end of a queue or of the free list)
+const unsigned int NO_ORDER = 0xFFFFFFFF;
+
+// an order resting in the book, a node of the queue of its price level
+struct BookOrder {
+  unsigned int       locateCode;
+  bool               buy;
+  unsigned int       price;
+  unsigned long long shares;
+  unsigned int       prev; // the previous order of the level (or NO_ORDER)
+  unsigned int       next; // the next order of the level (or of the free list)
+};
+
+// the best bid and ask of a stock, the price of an empty side is 0
+struct TopOfBook {
+  unsigned int       bidPrice  = 0;
+  unsigned long long bidShares = 0;
+  unsigned int       askPrice  = 0;
+  unsigned long long askShares = 0;
+};
+
+/**
+ * @brief      A slab of orders, the slots of released orders are reused
+ */
+class OrderPool {
+public:
+  // Functions
+  unsigned int allocate();
+  void release(unsigned int idx);
+  BookOrder& operator[](unsigned int idx) { return nodes[idx]; }
+  const BookOrder& operator[](unsigned int idx) const { return nodes[idx]; }
+  unsigned int size() const { return nodes.size(); } // including the released slots
+
+private:
+  Column<BookOrder> nodes;
+  unsigned int freeList = NO_ORDER;
+};
+
+/**
+ * @brief      An open addressing hash map (linear probing) from the order reference
+ *              to the index of the order in the OrderPool
+ */
+class OrderIndex {
+public:
+  OrderIndex() { rehash(1 << 16); }
+
+  // Functions
+  unsigned int find(unsigned long long orderRef) const;
+  void prefetch(unsigned long long orderRef) const { __builtin_prefetch(&slots[slot(orderRef)]); }
+  void insert(unsigned long long orderRef, unsigned int idx);
+  void erase(unsigned long long orderRef);
+  unsigned long long size() const { return count; }
+  template <typename F>
+  void forEach(F f) const {
+    for (Slot const& s : slots) {
+      if (s.orderRef != EMPTY) f(s.orderRef, s.idx);
+    }
+  }
+
+private:
+  // order references are 8 bytes, the largest value marks an empty slot
+  static const unsigned long long EMPTY = 0xFFFFFFFFFFFFFFFFULL;
+  struct Slot {
+    unsigned long long orderRef;
+    unsigned int       idx;
+  };
+
+  unsigned long long slot(unsigned long long orderRef) const {
+    // fibonacci hashing, the order references are mostly sequential
+    return (orderRef * 0x9E3779B97F4A7C15ULL) >> shift;
+  }
+  void rehash(unsigned long long size);
+
+  // Members
+  Column<Slot> slots;
+  unsigned long long mask  = 0;
+  unsigned int shift       = 64;
+  unsigned long long count = 0;
+};
+
+// the aggregated shares of a price level and the queue of its orders
+struct PriceLevel {
+  unsigned long long shares = 0;
+  unsigned int       head   = NO_ORDER;
+  unsigned int       tail   = NO_ORDER;
+};
+
+class PriceLadder {
+public:
+  explicit PriceLadder(bool bids = true) : bids(bids) {}
+
+  // Functions
+  void insert(OrderPool& pool, unsigned int idx);
+  void erase(OrderPool& pool, unsigned int idx);
+  void reduce(unsigned int price, unsigned long long shares);
+  bool best(unsigned int& price, unsigned long long& shares) const;
+  template <typename F>
+  void forEachOrder(OrderPool const& pool, F f) const;
+
+private:
+  // the number of levels of the ladder, a ladder uses 8KB once it is used
+  static const long long LADDER_SIZE = 512;
+
+  long long index(unsigned int price) const;
+  unsigned int levelPrice(long long idx) const { return anchor + (unsigned int) idx * tick; }
+  bool better(unsigned int a, unsigned int b) const { return bids ? a > b : a < b; }
+  PriceLevel& getLevel(unsigned int price, long long idx) { return idx >= 0 ? levels[idx] : far[price]; }
+  void removeLevel(unsigned int price, long long idx);
+  void findBest(long long from);
+  void recenter(unsigned int price);
+
+  // Members
+  bool bids;
+  unsigned int tick   = 0; // 0 until the first price, 100 (1 cent) for prices of at least 1 dollar
+  unsigned int anchor = 0; // the price of the first level
+  long long bestIdx   = -1; // the index of the best level of the ladder, -1 if it is empty
+  std::vector<PriceLevel> levels;          // the levels by tick offset from the anchor
+  std::map<unsigned int, PriceLevel> far;  // the levels of the prices outside of the ladder
+};
+
+/**
+ * @brief      Calls a function for each order of the side, the orders of a level
+ *              are visited in the order of their queue (time priority)
+ *
+ * @param[in]  pool  The pool of the orders
+ * @param[in]  f     The function, called with the index of the order in the pool
+ */
+template <typename F>
+void PriceLadder::forEachOrder(OrderPool const& pool, F f) const {
+  auto visit = [&](PriceLevel const& level) {
+    for (unsigned int idx = level.head; idx != NO_ORDER; idx = pool[idx].next) f(idx);
+  };
+  for (PriceLevel const& level : levels) visit(level);
+  for (auto const& it : far) visit(it.second);
+}
+
+class OrderBook {
+public:
+  OrderBook() = default;
+  OrderBook(OrderBook const&) = delete;
+  void operator=(OrderBook const&) = delete;
+
+  // Functions
+  void update(unsigned char* buf);
+  void add(unsigned long long orderRef, unsigned int locateCode, bool buy,
+           unsigned int price, unsigned long long shares);
+  bool reduce(unsigned long long orderRef, unsigned long long shares);
+  bool remove(unsigned long long orderRef);
+  bool replace(unsigned long long orderRef, unsigned long long newOrderRef,
+               unsigned long long shares, unsigned int price);
+  const BookOrder* find(unsigned long long orderRef) const;
+  void prefetch(unsigned long long orderRef) const { index.prefetch(orderRef); }
+  void prefetchOrder(unsigned long long orderRef) const;
+  TopOfBook top(unsigned int locateCode) const;
+  unsigned long long size() const { return index.size(); }
+  template <typename F>
+  void forEachOrder(F f) const;
+
+private:
+  // the price levels of one stock
+  struct Book {
+    PriceLadder bids{true};
+    PriceLadder asks{false};
+  };
+
+  Book& getBook(unsigned int locateCode);
+  PriceLadder& getSide(BookOrder const& order) {
+    Book& book = getBook(order.locateCode);
+    return order.buy ? book.bids : book.asks;
+  }
+  void remove(unsigned long long orderRef, unsigned int idx);
+
+  // Members
+  std::vector<Book> books; // by stock locate code, grown on first use
+  OrderPool pool;
+  OrderIndex index;
+};
+
+/**
+ * @brief      Calls a function for each order of the book, by stock and side,
+ *              the orders of a price level are visited in the order of their queue
+ *
+ * @param[in]  f     The function, called with the order reference number and the order
+ */
+template <typename F>
+void OrderBook::forEachOrder(F f) const {
+  // the nodes do not keep their order reference, it is taken from the index
+  std::vector<unsigned long long> refs(pool.size());
+  index.forEach([&](unsigned long long orderRef, unsigned int idx) { refs[idx] = orderRef; });
+
+  for (Book const& book : books) {
+    book.bids.forEachOrder(pool, [&](unsigned int idx) { f(refs[idx], pool[idx]); });
+    book.asks.forEachOrder(pool, [&](unsigned int idx) { f(refs[idx], pool[idx]); });
+  }
+}
+
+/**
+ * @brief      A batch of consecutive modifications ('E', 'C', 'X', 'D', and 'U'),
+ *              the messages are copied (the buffer can be refilled before they are applied)
+ *              and the slots of their orders are prefetched, thus the cache misses overlap
+ */
+class ModificationBatch {
+public:
+  // Functions
+  static bool isModification(unsigned char type) {
+    return type == 'E' || type == 'C' || type == 'X' || type == 'D' || type == 'U';
+  }
+  bool add(OrderBook const& book, unsigned char* buf);
+  template <typename F>
+  void apply(OrderBook const& book, F f);
+  bool empty() const { return count == 0; }
+
+private:
+  // the number of messages of a batch and the size of the longest modification ('C')
+  static const int BATCH_SIZE = 16;
+  static const int MAX_LENGTH = 36;
+
+  // Members
+  unsigned char messages[BATCH_SIZE][MAX_LENGTH];
+  int count = 0;
+};
+
+/**
+ * @brief      Applies the messages of the batch in order and empties the batch,
+ *              the orders of the messages are prefetched first
+ *
+ * @param[in]  book  The book, its index was prefetched when the messages were added
+ * @param[in]  f     The function that applies a message (the buffer starts at the message type)
+ */
+template <typename F>
+void ModificationBatch::apply(OrderBook const& book, F f) {
+  for (int i = 0; i < count; ++i) book.prefetchOrder(get8bytes(&messages[i][11]));
+  for (int i = 0; i < count; ++i) f(messages[i]);
+  count = 0;
+}
+
+#endif //ORDERBOOK_H
@@ -0,0 +1,136 @@
+#include "ParseBuffer.h"
+#include "Memory.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// the measured read throughput in bytes per second, 0 if nothing was measured yet
+static double readThroughput = 0.0;
+
+/**
+ * @brief      Returns the single instance of the buffer
+ *
+ * @return     The parse buffer
+ */
+ParseBuffer& ParseBuffer::instance() {
+  static ParseBuffer buffer;
+  return buffer;
+}
+
+/**
+ * @brief      Returns a buffer of at least the given size, the previous buffer is reused
+ *              if it is large enough but not more than twice the requested size.
+ *              The buffer is backed by huge pages if enabled (see Memory.h)
+ *
+ * @param[in]  size  The requested size in bytes
+ *
+ * @return     The pointer to the buffer
+ */
+unsigned char* ParseBuffer::get(unsigned long long size) {
+  if (buffer != NULL && capacity >= size && capacity <= 2 * size) return buffer;
+  
+  release();
+  buffer = (unsigned char*) allocateMemory(size);
+  if (buffer == NULL) Rcpp::stop("Could not allocate a buffer of %.0f bytes, try a smaller buffer_size", (double) size);
+  capacity = size;
+  return buffer;
+}
+
+/**
+ * @brief      Frees the buffer
+ */
+void ParseBuffer::release() {
+  if (buffer != NULL) freeMemory(buffer, capacity);
+  buffer   = NULL;
+  capacity = 0;
+}
+
+/**
+ * @brief      Frees the buffer if it is larger than MAX_RETAINED, thus large
+ *              buffers do not stay allocated for the rest of the R session
+ */
+void ParseBuffer::trim() {
+  if (capacity > MAX_RETAINED) release();
+}
+
+// @brief      Frees the parse buffer that is kept between calls
+//
+// @return     The number of freed bytes
+//
+// [[Rcpp::export]]
+double releaseBuffer_impl() {
+  const double bytes = (double) ParseBuffer::instance().size();
+  ParseBuffer::instance().release();
+  return bytes;
+}
+
+/**
+ * @brief      Returns the available memory (MemAvailable from /proc/meminfo, 
+ *              or the free physical pages where this is not available)
+ *
+ * @return     The available memory in bytes, 0 if unknown
+ */
+unsigned long long getAvailableMemory() {
+  FILE* meminfo = fopen("/proc/meminfo", "r");
+  if (meminfo != NULL) {
+    char line[256];
+    unsigned long long kb;
+    while (fgets(line, sizeof(line), meminfo) != NULL) {
+      if (sscanf(line, "MemAvailable: %llu kB", &kb) == 1) {
+        fclose(meminfo);
+        return kb * 1024ULL;
+      }
+    }
+    fclose(meminfo);
+  }
+#if defined(_SC_AVPHYS_PAGES) && defined(_SC_PAGESIZE)
+  long pages    = sysconf(_SC_AVPHYS_PAGES);
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if (pages > 0 && pageSize > 0) return (unsigned long long) pages * pageSize;
+#endif
+  return 0;
+}
+
+/**
+ * @brief      Records the throughput of the last read, used for the next getAutoBufferSize
+ *
+ * @param[in]  bytes    The number of bytes read
+ * @param[in]  seconds  The time spent reading
+ */
+void recordThroughput(unsigned long long bytes, double seconds) {
+  // too short reads do not give a reliable estimate
+  if (bytes < (1ULL << 20) || seconds <= 0.0) return;
+  readThroughput = bytes / seconds;
+}
+
+/**
+ * @brief      Chooses a buffer size for a file:
+ *              large enough that one fill takes about a quarter of a second at the 
+ *              measured read throughput (100MB if nothing was measured yet),
+ *              but not larger than the file, an eighth of the available memory, or 1GB
+ *
+ * @param[in]  filename  The filename
+ *
+ * @return     The buffer size in bytes
+ */
+unsigned long long getAutoBufferSize(std::string filename) {
+  const unsigned long long minSize = 1ULL << 20;
+  const unsigned long long maxSize = 1ULL << 30;
+  
+  unsigned long long size = readThroughput > 0.0 ? (unsigned long long) (readThroughput / 4) : 1e8;
+  
+  struct stat st;
+  if (stat(filename.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+    size = std::min(size, (unsigned long long) st.st_size + 2);
+  }
+  
+  const unsigned long long memory = getAvailableMemory();
+  if (memory > 0) size = std::min(size, memory / 8);
+  
+  return std::max(minSize, std::min(size, maxSize));
+}
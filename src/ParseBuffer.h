@@ -0,0 +1,57 @@
+#ifndef PARSEBUFFER_H
+#define PARSEBUFFER_H
+
+#include <Rcpp.h>
+#include <string>
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * ParseBuffer holds the buffer into which the files are read.
+ *  A buffer of up to MAX_RETAINED bytes is kept between calls (i.e., countMessages
+ *  and loadToMessages) and is only reallocated if a different size is needed,
+ *  larger buffers are freed at the end of the call (see ParseBuffer::Scope).
+ *  release_buffer() frees the kept buffer from R.
+ *
+ * getAutoBufferSize chooses a buffer size from the available memory,
+ *  the file size, and the read throughput measured in earlier calls
+ * #################################################################
+ */
+
+class ParseBuffer {
+public:
+  // the maximum size of a buffer that is kept after a call
+  static const unsigned long long MAX_RETAINED = 100ULL << 20;
+
+  // trims the buffer at the end of a call, also if the call is aborted by an error
+  struct Scope {
+    Scope() = default;
+    ~Scope() { ParseBuffer::instance().trim(); }
+    Scope(Scope const&) = delete;
+    void operator=(Scope const&) = delete;
+  };
+
+  static ParseBuffer& instance();
+
+  // Functions
+  unsigned char* get(unsigned long long size);
+  unsigned long long size() const { return capacity; }
+  void release();
+  void trim();
+
+private:
+  ParseBuffer() = default;
+  ~ParseBuffer() { release(); }
+  ParseBuffer(ParseBuffer const&) = delete;
+  void operator=(ParseBuffer const&) = delete;
+
+  // Members
+  unsigned char* buffer = NULL;
+  unsigned long long capacity = 0;
+};
+
+unsigned long long getAutoBufferSize(std::string filename);
+unsigned long long getAvailableMemory();
+void recordThroughput(unsigned long long bytes, double seconds);
+
+#endif //PARSEBUFFER_H
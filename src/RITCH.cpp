@@ -1,4 +1,6 @@
 #include "RITCH.h"
+#include <cstdlib>
+#include <cstring>
 
 /**
  * @brief      Returns the lengths of a given message type
@@ -114,92 +116,220 @@ int getMessagePosition(unsigned char msgType) {
   }
 }
 
+// the prefix of the filename of an R connection, followed by the number of the connection
+static const std::string CONNECTION_PREFIX = "<connection ";
+
 /**
- * @brief      Loads the contents of a plain-text file into a MessageType
+ * @brief      Opens the input
+ *
+ * @param[in]  filename  The filename, "-" for stdin, "| cmd" for the output of a command,
+ *                         or "<connection N>" for the open R connection with the number N
+ */
+InputFile::InputFile(std::string filename) {
+  if (filename.compare(0, CONNECTION_PREFIX.size(), CONNECTION_PREFIX) == 0) {
+    type = INPUT_CONNECTION;
+    const int number = atoi(filename.c_str() + CONNECTION_PREFIX.size());
+    Rcpp::Function getConnection("getConnection", Rcpp::Environment::base_namespace());
+    connection = getConnection(number);
+    return;
+  } else if (filename == "-") {
+    type = INPUT_STDIN;
+    file = stdin;
+  } else if (!filename.empty() && filename[0] == '|') {
+    type = INPUT_COMMAND;
+#ifdef _WIN32
+    file = _popen(filename.substr(1).c_str(), "rb");
+#else
+    file = popen(filename.substr(1).c_str(), "r");
+#endif
+  } else {
+    file = fopen(filename.c_str(), "rb");
+  }
+  if (file == NULL) Rcpp::stop("File Error!\n");
+}
+
+InputFile::~InputFile() {
+  if (file == NULL) return;
+  switch (type) {
+    case INPUT_COMMAND:
+#ifdef _WIN32
+      _pclose(file);
+#else
+      pclose(file);
+#endif
+      break;
+    case INPUT_FILE:
+      fclose(file);
+      break;
+    case INPUT_STDIN:
+    case INPUT_CONNECTION:
+      // stdin and R connections stay open
+      break;
+  }
+}
+
+/**
+ * @brief      Reads the next bytes of the input
+ *
+ * @param      buf   The buffer
+ * @param[in]  size  The maximum number of bytes
  *
- * @param[in]  filename       The filename to the plain-text file
+ * @return     The number of bytes read, 0 at the end of the input
+ */
+unsigned long long InputFile::read(unsigned char* buf, unsigned long long size) {
+  if (type != INPUT_CONNECTION) return fread(buf, 1, size, file);
+
+  // readBin returns fewer bytes only at the end of the input (for blocking connections)
+  Rcpp::Function readBin("readBin", Rcpp::Environment::base_namespace());
+  Rcpp::RawVector chunk = readBin(connection, "raw", (double) size);
+  if (chunk.size() > 0) memcpy(buf, RAW(chunk), chunk.size());
+  return chunk.size();
+}
+
+/**
+ * @brief      Checks if a filename refers to a stream (stdin, a command, or an R connection), 
+ *              which can only be read once
+ *
+ * @param[in]  filename  The filename
+ *
+ * @return     true if the input is a stream
+ */
+bool InputFile::isStream(std::string filename) {
+  return filename == "-" || (!filename.empty() && filename[0] == '|') ||
+    filename.compare(0, CONNECTION_PREFIX.size(), CONNECTION_PREFIX) == 0;
+}
+
+/**
+ * @brief      Loads the complete messages of a buffer into a MessageType, 
+ *              the messages are framed and converted by the layout of their ITCH version
+ *
+ * @param      bufferPtr       The buffer
+ * @param[in]  thisBufferSize  The number of bytes in the buffer
+ * @param      inBufferIdx     The index of the first message, set to the index of the first 
+ *                               message that is not loaded (a partial message)
+ * @param      layout          The layout (see Layout.h)
+ * @param      msg             The messagetype, or a subtype of it, which holds the information
+ * @param      filter          The filter of the messages
+ *
+ * @return     false if no later message is loaded (the endMsgCount has been reached 
+ *              or the market session has ended), otherwise true
+ */
+template <typename Layout>
+static bool loadBuffer(unsigned char* bufferPtr,
+                       unsigned long long thisBufferSize,
+                       unsigned long long& inBufferIdx,
+                       Layout& layout,
+                       MessageType& msg,
+                       MessageFilter& filter) {
+  // loop through the buffer by the index inBufferIdx
+  while (1) {
+    // if there is no partial message, this will be triggered
+    if (inBufferIdx >= thisBufferSize) break;
+    
+    const unsigned long long thisMsgLength = layout.length(bufferPtr[inBufferIdx]);
+    // if there is a partial message, it is carried over to the next buffer
+    if (inBufferIdx + thisMsgLength > thisBufferSize) break;
+    
+    // try to load the message, the filter is checked before the message is decoded, 
+    // false if the endMsgCount has been reached or the market session has ended, no need to continue
+    unsigned char* message = layout.normalize(&bufferPtr[inBufferIdx]);
+    if (message != NULL && !filter.load(msg, message)) return false;
+    
+    // increase the index in the buffer
+    inBufferIdx += thisMsgLength; 
+    // two empty strings after each message...
+    inBufferIdx += 2;
+  }
+  return true;
+}
+
+/**
+ * @brief      Loads the contents of a plain-text file into a MessageType,
+ *              the ITCH version (5.0 or 4.1) is detected from the first messages
+ *
+ * @param[in]  filename       The filename to the plain-text file, "-" for stdin, or "| cmd" 
+ *                              for the output of a command (see InputFile)
  * @param      msg            The messagetype, or a subtype of it, which holds the information
  * @param[in]  startMsgCount  The start message count, the message (order) count at which we 
  *                              start to save the messages, the defaults to 0 (first message)
  * @param[in]  endMsgCount    The end message count, the message count at which we stop to 
  *                              stop to save the messages, defaults to 0, which will be 
  *                              substituted to all messages
- * @param[in]  bufferSize     The buffer size in bytes, defaults to 100MB
+ * @param[in]  bufferSize     The buffer size in bytes, defaults to 100MB, 0 chooses the size automatically
  * @param[in]  quiet          If true, no status message is printed, defaults to false
+ * @param[in]  filter         The filter of the messages (by stock, market session, and trading state,
+ *                              see MessageFilter),
+ *                              defaults to a filter that loads all messages
  */
 void loadToMessages(std::string filename, 
                     MessageType& msg,
                     unsigned long long startMsgCount,
                     unsigned long long endMsgCount,
                     unsigned long long bufferSize,
-                    bool quiet) {
+                    bool quiet,
+                    MessageFilter filter) {
 
   msg.setBoundaries(startMsgCount, endMsgCount);
   
   // Open the file
-  FILE* infile;
-  infile = fopen(filename.c_str(), "rb");
-  if (infile == NULL) {
-    Rcpp::stop("File Error!\n");
-  }
+  InputFile infile(filename);
   
-  unsigned char* bufferPtr;
+  // 0 chooses the buffer size automatically, the buffer is reused between calls
+  // (up to ParseBuffer::MAX_RETAINED bytes, larger buffers are freed when the scope ends)
+  if (bufferSize == 0) bufferSize = getAutoBufferSize(filename);
   unsigned long long bufferCharSize = sizeof(char) * bufferSize;
-  bufferPtr = (unsigned char*) malloc(bufferCharSize);
+  ParseBuffer::Scope bufferScope;
+  unsigned char* bufferPtr = ParseBuffer::instance().get(bufferCharSize);
   
   unsigned long long thisBufferSize = 0;
-  unsigned long long curFilePtr;
+  // the bytes of a partial message at the end of the last buffer, 
+  // which are moved to the front of the buffer (no seeking, thus pipes can be read)
+  unsigned long long carryOver = 0;
+  
+  // the version is detected from the first buffer, the layouts keep their state between buffers
+  bool detected = false;
+  ITCHVersion version = ITCH_50;
+  Layout50 layout50;
+  Layout41 layout41;
+  
+  // measure the read throughput for the next automatic buffer size
+  unsigned long long bytesRead = 0;
+  double readSeconds = 0.0;
+  std::chrono::steady_clock::time_point readStart = std::chrono::steady_clock::now();
   
-  // fill the buffer
-  while ((thisBufferSize = fread(bufferPtr, 1, bufferCharSize, infile)) > 0) {
+  // fill the buffer after the carried over bytes
+  while ((thisBufferSize = infile.read(&bufferPtr[carryOver], bufferCharSize - carryOver)) > 0) {
+    bytesRead   += thisBufferSize;
+    readSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - readStart).count();
+    thisBufferSize += carryOver;
+
     if (!quiet) Rcpp::Rcout << ".";
     Rcpp::checkUserInterrupt();
     
-    // find the byte number, where file-pointer currently points to 
-    curFilePtr = ftell(infile);
+    if (!detected) {
+      version  = detectVersion(bufferPtr, thisBufferSize);
+      detected = true;
+    }
     
     // use the current buffer to read in the messages
     unsigned long long inBufferIdx = 2;
-    unsigned long long thisMsgLength;
-    
-    // loop through the buffer by the index inBufferIdx
-    while (1) {
-      // if there is no partial message, this will be triggered
-      if (inBufferIdx >= thisBufferSize) break;
-      
-      thisMsgLength = getMessageLength(bufferPtr[inBufferIdx]);
-      // if there is a partial message, go to the next buffer (gz-file pointer will be reset to match this!)
-      if (inBufferIdx > thisBufferSize - thisMsgLength) break;
-      
-      // try to load the message
-      if (!msg.loadMessages(&bufferPtr[inBufferIdx])) {
-        // loadMessages returns false if the endMsgCount has been reached, no need to continue
-        free(bufferPtr);
-        fclose(infile);
-        return;
-      }
-      
-      // increase the index in the buffer
-      inBufferIdx += thisMsgLength; 
-      // two empty strings after each message...
-      inBufferIdx += 2;
+    const bool more = version == ITCH_41 ?
+      loadBuffer(bufferPtr, thisBufferSize, inBufferIdx, layout41, msg, filter) :
+      loadBuffer(bufferPtr, thisBufferSize, inBufferIdx, layout50, msg, filter);
+    if (!more) {
+      msg.finish();
+      recordThroughput(bytesRead, readSeconds);
+      return;
     }
     
-    // if the message doesn't fit, a new buffer will not solve the issue, as there is too little information for the given msg-length
-    if (inBufferIdx == 0) break;
+    // the last (partial) message starts 2 bytes before inBufferIdx (its length)
+    carryOver = thisBufferSize + 2 - inBufferIdx;
+    // if the message doesn't fit, a new buffer will not solve the issue
+    if (carryOver >= bufferCharSize) Rcpp::stop("The buffer is too small for a single message");
+    if (carryOver > 0) memmove(bufferPtr, &bufferPtr[inBufferIdx - 2], carryOver);
     
-    // reset the current fileptr if needed
-    // clear the remaining bits, the last partial message might be cut in two, thus reset the gz-file pointer
-    // remaining bits of the last message: curFilePtr - thisBufferSize + inBufferIdx - 2
-    if (thisBufferSize != inBufferIdx) {
-      // std::cout << "reset to " << curFilePtr - thisBufferSize + inBufferIdx - 2 << "\n";
-      fseek(infile, curFilePtr - thisBufferSize + inBufferIdx - 2, SEEK_SET);
-    } else {
-      // if the message perfectly ends, still set it back by 2, otherwise 2 bytes are skipped!
-      fseek(infile, curFilePtr - 2, SEEK_SET);
-    }
+    readStart = std::chrono::steady_clock::now();
   }
-  
-  free(bufferPtr);
-  fclose(infile);
+  msg.finish();
+  recordThroughput(bytesRead, readSeconds);
 }
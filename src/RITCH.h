@@ -6,10 +6,15 @@
 #include <vector>
 #include <cstdint>
 #include <limits>
+#include <chrono>
+#include <cstdio>
 
 // User Includes
 #include "MessageTypes.h"
 #include "Specifications.h"
+#include "ParseBuffer.h"
+#include "MessageFilter.h"
+#include "Layout.h"
 // [[Rcpp::plugins("cpp11")]]
 
 /**
@@ -17,6 +22,9 @@
  * getMessageLength fetches the lengths for a given message
  * loadPlain load the contents of a file (plain-text or .gz)
  *  into the MessageType or its children (see MessageTypes.h)
+ * InputFile opens a file, stdin ("-"), the output of a command ("| cmd"),
+ *  or an R connection ("<connection N>"), all of them are read front to back (no seeking)
+ * ITCH 4.1 files are detected and read with their layout (see Layout.h)
  * #############################################################
  */
 
@@ -24,12 +32,37 @@
 unsigned long long getMessageLength(unsigned char msgType);
 int getMessagePosition(unsigned char msgType);
 
+/**
+ * @brief      An input that is read sequentially: a file, stdin (filename "-"),
+ *              the output of a shell command (filename "| cmd", i.e., "| zstd -dc file.zst"),
+ *              or an open R connection (filename "<connection N>", N is the number of the 
+ *              connection, read with readBin), the input is closed when the object is destroyed
+ *              (except stdin and R connections, which are closed by their owner)
+ */
+class InputFile {
+public:
+  explicit InputFile(std::string filename);
+  ~InputFile();
+  InputFile(InputFile const&) = delete;
+  void operator=(InputFile const&) = delete;
+
+  unsigned long long read(unsigned char* buf, unsigned long long size);
+  static bool isStream(std::string filename);
+
+private:
+  enum InputType { INPUT_FILE, INPUT_STDIN, INPUT_COMMAND, INPUT_CONNECTION };
+  FILE* file = NULL;
+  InputType type = INPUT_FILE;
+  Rcpp::RObject connection; // the R connection of INPUT_CONNECTION
+};
+
 // loads a plain-text file into the messagetype
 void loadToMessages(std::string filename, 
                     MessageType& msg,
                     unsigned long long startMsgCount = 0,
                     unsigned long long endMsgCount = std::numeric_limits<unsigned long long>::max(),
-                    unsigned long long bufferSize = 1e8,
-                    bool quiet = false);
+                    unsigned long long bufferSize = 1e8, // 0 chooses the size automatically
+                    bool quiet = false,
+                    MessageFilter filter = MessageFilter());
 
 #endif //RITCH_H
\ No newline at end of file
@@ -5,6 +5,61 @@
 
 using namespace Rcpp;
 
+// checkOrderBook_impl
+Rcpp::List checkOrderBook_impl(std::string filename);
+RcppExport SEXP _RITCH_checkOrderBook_impl(SEXP filenameSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP);
+    rcpp_result_gen = Rcpp::wrap(checkOrderBook_impl(filename));
+    return rcpp_result_gen;
+END_RCPP
+}
+// writeBook_impl
+Rcpp::DataFrame writeBook_impl(std::string filename, std::string bookFile, Rcpp::NumericVector times, unsigned long long bufferSize, Rcpp::IntegerVector stockLocate, bool quiet);
+RcppExport SEXP _RITCH_writeBook_impl(SEXP filenameSEXP, SEXP bookFileSEXP, SEXP timesSEXP, SEXP bufferSizeSEXP, SEXP stockLocateSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP);
+    Rcpp::traits::input_parameter< std::string >::type bookFile(bookFileSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type bufferSize(bufferSizeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(writeBook_impl(filename, bookFile, times, bufferSize, stockLocate, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// writeSessionBook_impl
+Rcpp::DataFrame writeSessionBook_impl(SEXP session, std::string bookFile, Rcpp::NumericVector times, Rcpp::IntegerVector stockLocate, bool quiet);
+RcppExport SEXP _RITCH_writeSessionBook_impl(SEXP sessionSEXP, SEXP bookFileSEXP, SEXP timesSEXP, SEXP stockLocateSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< std::string >::type bookFile(bookFileSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(writeSessionBook_impl(session, bookFile, times, stockLocate, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// readBook_impl
+Rcpp::DataFrame readBook_impl(std::string bookFile, Rcpp::NumericVector times, Rcpp::IntegerVector stockLocate);
+RcppExport SEXP _RITCH_readBook_impl(SEXP bookFileSEXP, SEXP timesSEXP, SEXP stockLocateSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type bookFile(bookFileSEXP);
+    Rcpp::traits::input_parameter< Rcpp::NumericVector >::type times(timesSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    rcpp_result_gen = Rcpp::wrap(readBook_impl(bookFile, times, stockLocate));
+    return rcpp_result_gen;
+END_RCPP
+}
 // getMessageCountDF
 Rcpp::DataFrame getMessageCountDF(std::string filename, unsigned long long bufferSize, bool quiet);
 RcppExport SEXP _RITCH_getMessageCountDF(SEXP filenameSEXP, SEXP bufferSizeSEXP, SEXP quietSEXP) {
@@ -19,8 +74,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // getOrders_impl
-Rcpp::DataFrame getOrders_impl(std::string filename, unsigned long long startMsgCount, unsigned long long endMsgCount, unsigned long long bufferSize, bool quiet);
-RcppExport SEXP _RITCH_getOrders_impl(SEXP filenameSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP bufferSizeSEXP, SEXP quietSEXP) {
+Rcpp::RObject getOrders_impl(std::string filename, unsigned long long startMsgCount, unsigned long long endMsgCount, unsigned long long bufferSize, Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode, bool arrow, bool quiet);
+RcppExport SEXP _RITCH_getOrders_impl(SEXP filenameSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP bufferSizeSEXP, SEXP stockLocateSEXP, SEXP marketSessionSEXP, SEXP tradingModeSEXP, SEXP arrowSEXP, SEXP quietSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -28,14 +83,18 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< unsigned long long >::type startMsgCount(startMsgCountSEXP);
     Rcpp::traits::input_parameter< unsigned long long >::type endMsgCount(endMsgCountSEXP);
     Rcpp::traits::input_parameter< unsigned long long >::type bufferSize(bufferSizeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< int >::type marketSession(marketSessionSEXP);
+    Rcpp::traits::input_parameter< int >::type tradingMode(tradingModeSEXP);
+    Rcpp::traits::input_parameter< bool >::type arrow(arrowSEXP);
     Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
-    rcpp_result_gen = Rcpp::wrap(getOrders_impl(filename, startMsgCount, endMsgCount, bufferSize, quiet));
+    rcpp_result_gen = Rcpp::wrap(getOrders_impl(filename, startMsgCount, endMsgCount, bufferSize, stockLocate, marketSession, tradingMode, arrow, quiet));
     return rcpp_result_gen;
 END_RCPP
 }
 // getTrades_impl
-Rcpp::DataFrame getTrades_impl(std::string filename, unsigned long long startMsgCount, unsigned long long endMsgCount, unsigned long long bufferSize, bool quiet);
-RcppExport SEXP _RITCH_getTrades_impl(SEXP filenameSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP bufferSizeSEXP, SEXP quietSEXP) {
+Rcpp::RObject getTrades_impl(std::string filename, unsigned long long startMsgCount, unsigned long long endMsgCount, unsigned long long bufferSize, Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode, int brokenMode, bool arrow, bool quiet);
+RcppExport SEXP _RITCH_getTrades_impl(SEXP filenameSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP bufferSizeSEXP, SEXP stockLocateSEXP, SEXP marketSessionSEXP, SEXP tradingModeSEXP, SEXP brokenModeSEXP, SEXP arrowSEXP, SEXP quietSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -43,32 +102,428 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< unsigned long long >::type startMsgCount(startMsgCountSEXP);
     Rcpp::traits::input_parameter< unsigned long long >::type endMsgCount(endMsgCountSEXP);
     Rcpp::traits::input_parameter< unsigned long long >::type bufferSize(bufferSizeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< int >::type marketSession(marketSessionSEXP);
+    Rcpp::traits::input_parameter< int >::type tradingMode(tradingModeSEXP);
+    Rcpp::traits::input_parameter< int >::type brokenMode(brokenModeSEXP);
+    Rcpp::traits::input_parameter< bool >::type arrow(arrowSEXP);
     Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
-    rcpp_result_gen = Rcpp::wrap(getTrades_impl(filename, startMsgCount, endMsgCount, bufferSize, quiet));
+    rcpp_result_gen = Rcpp::wrap(getTrades_impl(filename, startMsgCount, endMsgCount, bufferSize, stockLocate, marketSession, tradingMode, brokenMode, arrow, quiet));
     return rcpp_result_gen;
 END_RCPP
 }
 // getModifications_impl
-Rcpp::DataFrame getModifications_impl(std::string filename, unsigned long long startMsgCount, unsigned long long endMsgCount, unsigned long long bufferSize, bool quiet);
-RcppExport SEXP _RITCH_getModifications_impl(SEXP filenameSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP bufferSizeSEXP, SEXP quietSEXP) {
+Rcpp::RObject getModifications_impl(std::string filename, unsigned long long startMsgCount, unsigned long long endMsgCount, unsigned long long bufferSize, Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode, bool arrow, bool quiet);
+RcppExport SEXP _RITCH_getModifications_impl(SEXP filenameSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP bufferSizeSEXP, SEXP stockLocateSEXP, SEXP marketSessionSEXP, SEXP tradingModeSEXP, SEXP arrowSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type startMsgCount(startMsgCountSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type endMsgCount(endMsgCountSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type bufferSize(bufferSizeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< int >::type marketSession(marketSessionSEXP);
+    Rcpp::traits::input_parameter< int >::type tradingMode(tradingModeSEXP);
+    Rcpp::traits::input_parameter< bool >::type arrow(arrowSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getModifications_impl(filename, startMsgCount, endMsgCount, bufferSize, stockLocate, marketSession, tradingMode, arrow, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getMarketActivity_impl
+Rcpp::DataFrame getMarketActivity_impl(std::string filename, unsigned long long bufferSize, double resolution, Rcpp::IntegerVector stockLocate, bool quiet);
+RcppExport SEXP _RITCH_getMarketActivity_impl(SEXP filenameSEXP, SEXP bufferSizeSEXP, SEXP resolutionSEXP, SEXP stockLocateSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type bufferSize(bufferSizeSEXP);
+    Rcpp::traits::input_parameter< double >::type resolution(resolutionSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getMarketActivity_impl(filename, bufferSize, resolution, stockLocate, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getSessionMarketActivity_impl
+Rcpp::DataFrame getSessionMarketActivity_impl(SEXP session, double resolution, Rcpp::IntegerVector stockLocate, bool quiet);
+RcppExport SEXP _RITCH_getSessionMarketActivity_impl(SEXP sessionSEXP, SEXP resolutionSEXP, SEXP stockLocateSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< double >::type resolution(resolutionSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getSessionMarketActivity_impl(session, resolution, stockLocate, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// setHugePages_impl
+void setHugePages_impl(int mode);
+RcppExport SEXP _RITCH_setHugePages_impl(SEXP modeSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type mode(modeSEXP);
+    setHugePages_impl(mode);
+    return R_NilValue;
+END_RCPP
+}
+// getHugePages_impl
+Rcpp::List getHugePages_impl();
+RcppExport SEXP _RITCH_getHugePages_impl() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(getHugePages_impl());
+    return rcpp_result_gen;
+END_RCPP
+}
+// getMidPrices_impl
+Rcpp::List getMidPrices_impl(std::string filename, unsigned long long bufferSize, std::vector<double> resolutions, bool regularOnly, Rcpp::IntegerVector stockLocate, std::string bookFile, bool quiet);
+RcppExport SEXP _RITCH_getMidPrices_impl(SEXP filenameSEXP, SEXP bufferSizeSEXP, SEXP resolutionsSEXP, SEXP regularOnlySEXP, SEXP stockLocateSEXP, SEXP bookFileSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type bufferSize(bufferSizeSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type resolutions(resolutionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type regularOnly(regularOnlySEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< std::string >::type bookFile(bookFileSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getMidPrices_impl(filename, bufferSize, resolutions, regularOnly, stockLocate, bookFile, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getSessionMidPrices_impl
+Rcpp::List getSessionMidPrices_impl(SEXP session, std::vector<double> resolutions, bool regularOnly, Rcpp::IntegerVector stockLocate, std::string bookFile, bool quiet);
+RcppExport SEXP _RITCH_getSessionMidPrices_impl(SEXP sessionSEXP, SEXP resolutionsSEXP, SEXP regularOnlySEXP, SEXP stockLocateSEXP, SEXP bookFileSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type resolutions(resolutionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type regularOnly(regularOnlySEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< std::string >::type bookFile(bookFileSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getSessionMidPrices_impl(session, resolutions, regularOnly, stockLocate, bookFile, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getMPIDActivity_impl
+Rcpp::DataFrame getMPIDActivity_impl(std::string filename, unsigned long long bufferSize, Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode, bool positions, bool quiet);
+RcppExport SEXP _RITCH_getMPIDActivity_impl(SEXP filenameSEXP, SEXP bufferSizeSEXP, SEXP stockLocateSEXP, SEXP marketSessionSEXP, SEXP tradingModeSEXP, SEXP positionsSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type bufferSize(bufferSizeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< int >::type marketSession(marketSessionSEXP);
+    Rcpp::traits::input_parameter< int >::type tradingMode(tradingModeSEXP);
+    Rcpp::traits::input_parameter< bool >::type positions(positionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getMPIDActivity_impl(filename, bufferSize, stockLocate, marketSession, tradingMode, positions, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getSessionMPIDActivity_impl
+Rcpp::DataFrame getSessionMPIDActivity_impl(SEXP session, Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode, bool positions, bool quiet);
+RcppExport SEXP _RITCH_getSessionMPIDActivity_impl(SEXP sessionSEXP, SEXP stockLocateSEXP, SEXP marketSessionSEXP, SEXP tradingModeSEXP, SEXP positionsSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< int >::type marketSession(marketSessionSEXP);
+    Rcpp::traits::input_parameter< int >::type tradingMode(tradingModeSEXP);
+    Rcpp::traits::input_parameter< bool >::type positions(positionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getSessionMPIDActivity_impl(session, stockLocate, marketSession, tradingMode, positions, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// releaseBuffer_impl
+double releaseBuffer_impl();
+RcppExport SEXP _RITCH_releaseBuffer_impl() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(releaseBuffer_impl());
+    return rcpp_result_gen;
+END_RCPP
+}
+// socketDir_impl
+void socketDir_impl(std::string path);
+RcppExport SEXP _RITCH_socketDir_impl(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    socketDir_impl(path);
+    return R_NilValue;
+END_RCPP
+}
+// serverListen_impl
+int serverListen_impl(std::string path);
+RcppExport SEXP _RITCH_serverListen_impl(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    rcpp_result_gen = Rcpp::wrap(serverListen_impl(path));
+    return rcpp_result_gen;
+END_RCPP
+}
+// serverAccept_impl
+SEXP serverAccept_impl(int fd, double waitTimeout, double requestTimeout);
+RcppExport SEXP _RITCH_serverAccept_impl(SEXP fdSEXP, SEXP waitTimeoutSEXP, SEXP requestTimeoutSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type fd(fdSEXP);
+    Rcpp::traits::input_parameter< double >::type waitTimeout(waitTimeoutSEXP);
+    Rcpp::traits::input_parameter< double >::type requestTimeout(requestTimeoutSEXP);
+    rcpp_result_gen = Rcpp::wrap(serverAccept_impl(fd, waitTimeout, requestTimeout));
+    return rcpp_result_gen;
+END_RCPP
+}
+// serverRespond_impl
+bool serverRespond_impl(int conn, Rcpp::RawVector response, double timeout);
+RcppExport SEXP _RITCH_serverRespond_impl(SEXP connSEXP, SEXP responseSEXP, SEXP timeoutSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< Rcpp::RawVector >::type response(responseSEXP);
+    Rcpp::traits::input_parameter< double >::type timeout(timeoutSEXP);
+    rcpp_result_gen = Rcpp::wrap(serverRespond_impl(conn, response, timeout));
+    return rcpp_result_gen;
+END_RCPP
+}
+// serverClose_impl
+void serverClose_impl(int fd, std::string path);
+RcppExport SEXP _RITCH_serverClose_impl(SEXP fdSEXP, SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type fd(fdSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    serverClose_impl(fd, path);
+    return R_NilValue;
+END_RCPP
+}
+// clientRequest_impl
+Rcpp::RawVector clientRequest_impl(std::string path, std::string request, double timeout);
+RcppExport SEXP _RITCH_clientRequest_impl(SEXP pathSEXP, SEXP requestSEXP, SEXP timeoutSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type request(requestSEXP);
+    Rcpp::traits::input_parameter< double >::type timeout(timeoutSEXP);
+    rcpp_result_gen = Rcpp::wrap(clientRequest_impl(path, request, timeout));
+    return rcpp_result_gen;
+END_RCPP
+}
+// openSession_impl
+SEXP openSession_impl(std::string filename);
+RcppExport SEXP _RITCH_openSession_impl(SEXP filenameSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP);
+    rcpp_result_gen = Rcpp::wrap(openSession_impl(filename));
+    return rcpp_result_gen;
+END_RCPP
+}
+// closeSession_impl
+void closeSession_impl(SEXP session);
+RcppExport SEXP _RITCH_closeSession_impl(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    closeSession_impl(session);
+    return R_NilValue;
+END_RCPP
+}
+// getSessionInfo_impl
+Rcpp::List getSessionInfo_impl(SEXP session);
+RcppExport SEXP _RITCH_getSessionInfo_impl(SEXP sessionSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    rcpp_result_gen = Rcpp::wrap(getSessionInfo_impl(session));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getSessionCountDF_impl
+Rcpp::DataFrame getSessionCountDF_impl(SEXP session, bool quiet);
+RcppExport SEXP _RITCH_getSessionCountDF_impl(SEXP sessionSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getSessionCountDF_impl(session, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getSessionOrders_impl
+Rcpp::RObject getSessionOrders_impl(SEXP session, unsigned long long startMsgCount, unsigned long long endMsgCount, Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode, bool arrow, bool quiet);
+RcppExport SEXP _RITCH_getSessionOrders_impl(SEXP sessionSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP stockLocateSEXP, SEXP marketSessionSEXP, SEXP tradingModeSEXP, SEXP arrowSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type startMsgCount(startMsgCountSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type endMsgCount(endMsgCountSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< int >::type marketSession(marketSessionSEXP);
+    Rcpp::traits::input_parameter< int >::type tradingMode(tradingModeSEXP);
+    Rcpp::traits::input_parameter< bool >::type arrow(arrowSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getSessionOrders_impl(session, startMsgCount, endMsgCount, stockLocate, marketSession, tradingMode, arrow, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getSessionTrades_impl
+Rcpp::RObject getSessionTrades_impl(SEXP session, unsigned long long startMsgCount, unsigned long long endMsgCount, Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode, int brokenMode, bool arrow, bool quiet);
+RcppExport SEXP _RITCH_getSessionTrades_impl(SEXP sessionSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP stockLocateSEXP, SEXP marketSessionSEXP, SEXP tradingModeSEXP, SEXP brokenModeSEXP, SEXP arrowSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type startMsgCount(startMsgCountSEXP);
+    Rcpp::traits::input_parameter< unsigned long long >::type endMsgCount(endMsgCountSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< int >::type marketSession(marketSessionSEXP);
+    Rcpp::traits::input_parameter< int >::type tradingMode(tradingModeSEXP);
+    Rcpp::traits::input_parameter< int >::type brokenMode(brokenModeSEXP);
+    Rcpp::traits::input_parameter< bool >::type arrow(arrowSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getSessionTrades_impl(session, startMsgCount, endMsgCount, stockLocate, marketSession, tradingMode, brokenMode, arrow, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getSessionModifications_impl
+Rcpp::RObject getSessionModifications_impl(SEXP session, unsigned long long startMsgCount, unsigned long long endMsgCount, Rcpp::IntegerVector stockLocate, int marketSession, int tradingMode, bool arrow, bool quiet);
+RcppExport SEXP _RITCH_getSessionModifications_impl(SEXP sessionSEXP, SEXP startMsgCountSEXP, SEXP endMsgCountSEXP, SEXP stockLocateSEXP, SEXP marketSessionSEXP, SEXP tradingModeSEXP, SEXP arrowSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
     Rcpp::traits::input_parameter< unsigned long long >::type startMsgCount(startMsgCountSEXP);
     Rcpp::traits::input_parameter< unsigned long long >::type endMsgCount(endMsgCountSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< int >::type marketSession(marketSessionSEXP);
+    Rcpp::traits::input_parameter< int >::type tradingMode(tradingModeSEXP);
+    Rcpp::traits::input_parameter< bool >::type arrow(arrowSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getSessionModifications_impl(session, startMsgCount, endMsgCount, stockLocate, marketSession, tradingMode, arrow, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// setThreads_impl
+int setThreads_impl(int threads, bool pin);
+RcppExport SEXP _RITCH_setThreads_impl(SEXP threadsSEXP, SEXP pinSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type pin(pinSEXP);
+    rcpp_result_gen = Rcpp::wrap(setThreads_impl(threads, pin));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getThreads_impl
+Rcpp::List getThreads_impl();
+RcppExport SEXP _RITCH_getThreads_impl() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(getThreads_impl());
+    return rcpp_result_gen;
+END_RCPP
+}
+// getThreadStats_impl
+Rcpp::DataFrame getThreadStats_impl();
+RcppExport SEXP _RITCH_getThreadStats_impl() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(getThreadStats_impl());
+    return rcpp_result_gen;
+END_RCPP
+}
+// getTradeQuotes_impl
+Rcpp::DataFrame getTradeQuotes_impl(std::string filename, unsigned long long bufferSize, Rcpp::IntegerVector stockLocate, std::string bookFile, bool quiet);
+RcppExport SEXP _RITCH_getTradeQuotes_impl(SEXP filenameSEXP, SEXP bufferSizeSEXP, SEXP stockLocateSEXP, SEXP bookFileSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type filename(filenameSEXP);
     Rcpp::traits::input_parameter< unsigned long long >::type bufferSize(bufferSizeSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< std::string >::type bookFile(bookFileSEXP);
+    Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
+    rcpp_result_gen = Rcpp::wrap(getTradeQuotes_impl(filename, bufferSize, stockLocate, bookFile, quiet));
+    return rcpp_result_gen;
+END_RCPP
+}
+// getSessionTradeQuotes_impl
+Rcpp::DataFrame getSessionTradeQuotes_impl(SEXP session, Rcpp::IntegerVector stockLocate, std::string bookFile, bool quiet);
+RcppExport SEXP _RITCH_getSessionTradeQuotes_impl(SEXP sessionSEXP, SEXP stockLocateSEXP, SEXP bookFileSEXP, SEXP quietSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type session(sessionSEXP);
+    Rcpp::traits::input_parameter< Rcpp::IntegerVector >::type stockLocate(stockLocateSEXP);
+    Rcpp::traits::input_parameter< std::string >::type bookFile(bookFileSEXP);
     Rcpp::traits::input_parameter< bool >::type quiet(quietSEXP);
-    rcpp_result_gen = Rcpp::wrap(getModifications_impl(filename, startMsgCount, endMsgCount, bufferSize, quiet));
+    rcpp_result_gen = Rcpp::wrap(getSessionTradeQuotes_impl(session, stockLocate, bookFile, quiet));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_RITCH_checkOrderBook_impl", (DL_FUNC) &_RITCH_checkOrderBook_impl, 1},
+    {"_RITCH_writeBook_impl", (DL_FUNC) &_RITCH_writeBook_impl, 6},
+    {"_RITCH_writeSessionBook_impl", (DL_FUNC) &_RITCH_writeSessionBook_impl, 5},
+    {"_RITCH_readBook_impl", (DL_FUNC) &_RITCH_readBook_impl, 3},
     {"_RITCH_getMessageCountDF", (DL_FUNC) &_RITCH_getMessageCountDF, 3},
-    {"_RITCH_getOrders_impl", (DL_FUNC) &_RITCH_getOrders_impl, 5},
-    {"_RITCH_getTrades_impl", (DL_FUNC) &_RITCH_getTrades_impl, 5},
-    {"_RITCH_getModifications_impl", (DL_FUNC) &_RITCH_getModifications_impl, 5},
+    {"_RITCH_getOrders_impl", (DL_FUNC) &_RITCH_getOrders_impl, 9},
+    {"_RITCH_getTrades_impl", (DL_FUNC) &_RITCH_getTrades_impl, 10},
+    {"_RITCH_getModifications_impl", (DL_FUNC) &_RITCH_getModifications_impl, 9},
+    {"_RITCH_getMarketActivity_impl", (DL_FUNC) &_RITCH_getMarketActivity_impl, 5},
+    {"_RITCH_getSessionMarketActivity_impl", (DL_FUNC) &_RITCH_getSessionMarketActivity_impl, 4},
+    {"_RITCH_setHugePages_impl", (DL_FUNC) &_RITCH_setHugePages_impl, 1},
+    {"_RITCH_getHugePages_impl", (DL_FUNC) &_RITCH_getHugePages_impl, 0},
+    {"_RITCH_getMidPrices_impl", (DL_FUNC) &_RITCH_getMidPrices_impl, 7},
+    {"_RITCH_getSessionMidPrices_impl", (DL_FUNC) &_RITCH_getSessionMidPrices_impl, 6},
+    {"_RITCH_getMPIDActivity_impl", (DL_FUNC) &_RITCH_getMPIDActivity_impl, 7},
+    {"_RITCH_getSessionMPIDActivity_impl", (DL_FUNC) &_RITCH_getSessionMPIDActivity_impl, 6},
+    {"_RITCH_releaseBuffer_impl", (DL_FUNC) &_RITCH_releaseBuffer_impl, 0},
+    {"_RITCH_socketDir_impl", (DL_FUNC) &_RITCH_socketDir_impl, 1},
+    {"_RITCH_serverListen_impl", (DL_FUNC) &_RITCH_serverListen_impl, 1},
+    {"_RITCH_serverAccept_impl", (DL_FUNC) &_RITCH_serverAccept_impl, 3},
+    {"_RITCH_serverRespond_impl", (DL_FUNC) &_RITCH_serverRespond_impl, 3},
+    {"_RITCH_serverClose_impl", (DL_FUNC) &_RITCH_serverClose_impl, 2},
+    {"_RITCH_clientRequest_impl", (DL_FUNC) &_RITCH_clientRequest_impl, 3},
+    {"_RITCH_openSession_impl", (DL_FUNC) &_RITCH_openSession_impl, 1},
+    {"_RITCH_closeSession_impl", (DL_FUNC) &_RITCH_closeSession_impl, 1},
+    {"_RITCH_getSessionInfo_impl", (DL_FUNC) &_RITCH_getSessionInfo_impl, 1},
+    {"_RITCH_getSessionCountDF_impl", (DL_FUNC) &_RITCH_getSessionCountDF_impl, 2},
+    {"_RITCH_getSessionOrders_impl", (DL_FUNC) &_RITCH_getSessionOrders_impl, 8},
+    {"_RITCH_getSessionTrades_impl", (DL_FUNC) &_RITCH_getSessionTrades_impl, 9},
+    {"_RITCH_getSessionModifications_impl", (DL_FUNC) &_RITCH_getSessionModifications_impl, 8},
+    {"_RITCH_setThreads_impl", (DL_FUNC) &_RITCH_setThreads_impl, 2},
+    {"_RITCH_getThreads_impl", (DL_FUNC) &_RITCH_getThreads_impl, 0},
+    {"_RITCH_getThreadStats_impl", (DL_FUNC) &_RITCH_getThreadStats_impl, 0},
+    {"_RITCH_getTradeQuotes_impl", (DL_FUNC) &_RITCH_getTradeQuotes_impl, 5},
+    {"_RITCH_getSessionTradeQuotes_impl", (DL_FUNC) &_RITCH_getSessionTradeQuotes_impl, 4},
     {NULL, NULL, 0}
 };
 
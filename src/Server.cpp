@@ -0,0 +1,321 @@
+#include <Rcpp.h>
+#include <limits>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * The local socket of serve_itch() and query_itch(): a Unix domain socket
+ *  that is only accessible by the user of the server (mode 0600).
+ *
+ * A message is its length (8 bytes, big endian) followed by its bytes,
+ *  the requests are plain text (see parse_itch_request) and limited to
+ *  MAX_REQUEST bytes, the responses are serialized R objects.
+ *  The server reads a request with a timeout, thus a client that does not
+ *  send its request does not block the server.
+ *
+ * Both sides check that the other end of the socket is a process of the same
+ *  user (the peer credentials), thus a client does not read the response of a
+ *  socket that another user created at the path.
+ * #################################################################
+ */
+
+// the maximum size of a request in bytes
+const unsigned long long MAX_REQUEST = 1 << 16;
+
+#ifndef _WIN32
+
+/**
+ * @brief      Sets the timeouts of the reads and writes of a socket
+ *
+ * @param[in]  fd       The socket
+ * @param[in]  timeout  The timeout in seconds
+ */
+static void setTimeouts(int fd, double timeout) {
+  timeval tv;
+  tv.tv_sec  = (time_t) timeout;
+  tv.tv_usec = (suseconds_t) ((timeout - (double) tv.tv_sec) * 1e6);
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/**
+ * @brief      Fills the address of a socket path
+ *
+ * @param[in]  path  The path of the socket
+ *
+ * @return     The address
+ */
+static sockaddr_un getAddress(std::string const& path) {
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    Rcpp::stop("The socket path has to have between 1 and %d characters", (int) sizeof(addr.sun_path) - 1);
+  memcpy(addr.sun_path, path.c_str(), path.size());
+  return addr;
+}
+
+/**
+ * @brief      Checks that the other end of a connected socket is a process of the current user
+ *
+ * @param[in]  fd    The socket
+ *
+ * @return     true if the peer has the effective user id of this process
+ */
+static bool peerIsUser(int fd) {
+#if defined(SO_PEERCRED)
+  ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) return false;
+  return cred.uid == geteuid();
+#else
+  uid_t uid;
+  gid_t gid;
+  if (getpeereid(fd, &uid, &gid) != 0) return false;
+  return uid == geteuid();
+#endif
+}
+
+/**
+ * @brief      Reads exactly n bytes
+ *
+ * @return     false if the socket was closed, timed out, or failed
+ */
+static bool readAll(int fd, unsigned char* buf, unsigned long long n) {
+  while (n > 0) {
+    const ssize_t got = read(fd, buf, n);
+    if (got < 0 && errno == EINTR) continue;
+    if (got <= 0) return false;
+    buf += got;
+    n   -= got;
+  }
+  return true;
+}
+
+/**
+ * @brief      Writes exactly n bytes
+ *
+ * @return     false if the socket was closed, timed out, or failed
+ */
+static bool writeAll(int fd, const unsigned char* buf, unsigned long long n) {
+  while (n > 0) {
+    const ssize_t put = write(fd, buf, n);
+    if (put < 0 && errno == EINTR) continue;
+    if (put <= 0) return false;
+    buf += put;
+    n   -= put;
+  }
+  return true;
+}
+
+/**
+ * @brief      Writes a message (its length, then its bytes)
+ */
+static bool writeMessage(int fd, const unsigned char* buf, unsigned long long n) {
+  unsigned char len[8];
+  for (int i = 0; i < 8; ++i) len[i] = (n >> (8 * (7 - i))) & 0xFF;
+  return writeAll(fd, len, 8) && writeAll(fd, buf, n);
+}
+
+/**
+ * @brief      Reads a message (its length, then its bytes)
+ *
+ * @param[in]  maxSize  The maximum size of the message
+ * @param      out      The message
+ *
+ * @return     false if the message could not be read or is too large
+ */
+static bool readMessage(int fd, unsigned long long maxSize, std::vector<unsigned char>& out) {
+  unsigned char len[8];
+  if (!readAll(fd, len, 8)) return false;
+  unsigned long long n = 0;
+  for (int i = 0; i < 8; ++i) n = (n << 8) | len[i];
+  if (n > maxSize) return false;
+  out.resize(n);
+  return n == 0 || readAll(fd, out.data(), n);
+}
+
+#endif
+
+// @brief      Creates a private directory for the sockets (mode 0700), an existing directory
+//              has to be a directory of the current user that no other user can access
+//
+// @param[in]  path  The path of the directory
+//
+// [[Rcpp::export]]
+void socketDir_impl(std::string path) {
+#ifdef _WIN32
+  Rcpp::stop("The server is not supported on Windows");
+#else
+  if (mkdir(path.c_str(), 0700) != 0 && errno != EEXIST)
+    Rcpp::stop("Could not create %s: %s", path, strerror(errno));
+  // lstat, thus a symbolic link to another directory is rejected
+  struct stat st;
+  if (lstat(path.c_str(), &st) != 0) Rcpp::stop("Could not access %s: %s", path, strerror(errno));
+  if (!S_ISDIR(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & 0077) != 0)
+    Rcpp::stop("%s has to be a directory of the current user with mode 0700", path);
+#endif
+}
+
+// @brief      Creates the listening socket of the server, an existing socket at the path is replaced
+//
+// @param[in]  path  The path of the socket
+//
+// @return     The file descriptor of the socket
+//
+// [[Rcpp::export]]
+int serverListen_impl(std::string path) {
+#ifdef _WIN32
+  Rcpp::stop("The server is not supported on Windows");
+  return -1;
+#else
+  sockaddr_un addr = getAddress(path);
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0) {
+    if (!S_ISSOCK(st.st_mode)) Rcpp::stop("%s exists and is not a socket", path);
+    unlink(path.c_str());
+  }
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) Rcpp::stop("Could not create the socket: %s", strerror(errno));
+  // the socket is created with mode 0600, thus other users cannot connect
+  const mode_t mask = umask(0177);
+  const int res = bind(fd, (sockaddr*) &addr, sizeof(addr));
+  umask(mask);
+  if (res != 0 || listen(fd, 16) != 0) {
+    const std::string err = strerror(errno);
+    close(fd);
+    Rcpp::stop("Could not listen on %s: %s", path, err);
+  }
+  return fd;
+#endif
+}
+
+// @brief      Waits for a client and reads its request
+//
+// @param[in]  fd              The listening socket
+// @param[in]  waitTimeout     The time to wait for a client in seconds
+// @param[in]  requestTimeout  The time to read the request in seconds
+//
+// @return     A list with the socket of the client (conn) and the request (a string),
+//              NULL if no client connected or the request could not be read
+//
+// [[Rcpp::export]]
+SEXP serverAccept_impl(int fd, double waitTimeout, double requestTimeout) {
+#ifdef _WIN32
+  Rcpp::stop("The server is not supported on Windows");
+  return R_NilValue;
+#else
+  pollfd pfd;
+  pfd.fd     = fd;
+  pfd.events = POLLIN;
+  if (poll(&pfd, 1, (int) (waitTimeout * 1000)) <= 0) return R_NilValue;
+
+  const int conn = accept(fd, NULL, NULL);
+  if (conn < 0) return R_NilValue;
+  if (!peerIsUser(conn)) {
+    close(conn);
+    return R_NilValue;
+  }
+  setTimeouts(conn, requestTimeout);
+
+  std::vector<unsigned char> request;
+  if (!readMessage(conn, MAX_REQUEST, request)) {
+    close(conn);
+    return R_NilValue;
+  }
+  return Rcpp::List::create(
+    Rcpp::Named("conn")    = conn,
+    Rcpp::Named("request") = std::string(request.begin(), request.end())
+  );
+#endif
+}
+
+// @brief      Sends the response to a client and closes its socket
+//
+// @param[in]  conn      The socket of the client
+// @param[in]  response  The serialized response
+// @param[in]  timeout   The time to send the response in seconds
+//
+// @return     true if the response was sent
+//
+// [[Rcpp::export]]
+bool serverRespond_impl(int conn, Rcpp::RawVector response, double timeout) {
+#ifdef _WIN32
+  Rcpp::stop("The server is not supported on Windows");
+  return false;
+#else
+  setTimeouts(conn, timeout);
+  const bool ok = writeMessage(conn, RAW(response), response.size());
+  close(conn);
+  return ok;
+#endif
+}
+
+// @brief      Closes the listening socket of the server and removes its path
+//
+// @param[in]  fd    The listening socket
+// @param[in]  path  The path of the socket
+//
+// [[Rcpp::export]]
+void serverClose_impl(int fd, std::string path) {
+#ifndef _WIN32
+  close(fd);
+  unlink(path.c_str());
+#endif
+}
+
+// @brief      Sends a request to a server and returns its response
+//
+// @param[in]  path     The path of the socket of the server
+// @param[in]  request  The request
+// @param[in]  timeout  The time to wait for the response in seconds
+//
+// @return     The serialized response
+//
+// [[Rcpp::export]]
+Rcpp::RawVector clientRequest_impl(std::string path, std::string request, double timeout) {
+#ifdef _WIN32
+  Rcpp::stop("The server is not supported on Windows");
+  return Rcpp::RawVector();
+#else
+  if (request.size() > MAX_REQUEST) Rcpp::stop("The request is too large");
+  sockaddr_un addr = getAddress(path);
+
+  const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) Rcpp::stop("Could not create the socket: %s", strerror(errno));
+  if (connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0) {
+    const std::string err = strerror(errno);
+    close(fd);
+    Rcpp::stop("Could not connect to the server at %s: %s", path, err);
+  }
+  if (!peerIsUser(fd)) {
+    close(fd);
+    Rcpp::stop("The server at %s is not run by the current user", path);
+  }
+  setTimeouts(fd, timeout);
+
+  std::vector<unsigned char> response;
+  const bool ok = writeMessage(fd, (const unsigned char*) request.data(), request.size()) &&
+    readMessage(fd, std::numeric_limits<unsigned long long>::max(), response);
+  close(fd);
+  if (!ok) Rcpp::stop("No response from the server at %s", path);
+
+  Rcpp::RawVector res(response.size());
+  if (!response.empty()) memcpy(RAW(res), response.data(), response.size());
+  return res;
+#endif
+}
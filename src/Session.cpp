@@ -0,0 +1,474 @@
+#include "Session.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <utility>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief      Opens the file and maps it into memory, if the file cannot be mapped,
+ *              it is read into memory instead
+ *
+ * @param[in]  filename  The filename to a plain-text file
+ */
+ITCHSession::ITCHSession(std::string filename) : filename(filename) {
+#ifndef _WIN32
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) Rcpp::stop("File Error!\n");
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    ::close(fd);
+    Rcpp::stop("File Error!\n");
+  }
+  dataSize = st.st_size;
+  if (dataSize > 0) {
+    void* ptr = mmap(NULL, dataSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) {
+      data   = static_cast<unsigned char*>(ptr);
+      mapped = true;
+    }
+  }
+  ::close(fd);
+#endif
+
+  if (!mapped) {
+    FILE* infile = fopen(filename.c_str(), "rb");
+    if (infile == NULL) Rcpp::stop("File Error!\n");
+    fseek(infile, 0, SEEK_END);
+    dataSize = ftell(infile);
+    fseek(infile, 0, SEEK_SET);
+
+    if (dataSize > 0) {
+      data = static_cast<unsigned char*>(allocateMemory(dataSize));
+      if (data == NULL || fread(data, 1, dataSize, infile) != dataSize) {
+        if (data != NULL) freeMemory(data, dataSize);
+        data = NULL;
+        fclose(infile);
+        Rcpp::stop("Could not read the file into memory");
+      }
+    }
+    fclose(infile);
+  }
+  open = true;
+}
+
+ITCHSession::~ITCHSession() {
+  close();
+}
+
+/**
+ * @brief      Releases the memory of the file and the offsets, the session cannot be used afterwards
+ */
+void ITCHSession::close() {
+  if (!open) return;
+  if (data != NULL) {
+#ifndef _WIN32
+    if (mapped) munmap(data, dataSize);
+#endif
+    if (!mapped) freeMemory(data, dataSize);
+  }
+  data = NULL;
+  typeOffsets.clear();
+  locateOffsets.clear();
+  locatesSplit.clear();
+  framed = false;
+  open   = false;
+}
+
+/**
+ * @brief      Finds the offset of each message in the file and splits them by message type,
+ *              only done on the first call. An ITCH 4.1 file is converted into the 
+ *              ITCH 5.0 layout first (see Layout41), thus the queries read the 5.0 layout
+ */
+void ITCHSession::frame() {
+  if (framed) return;
+
+  if (data != NULL && detectVersion(data, dataSize) == ITCH_41) {
+    unsigned long long newSize = 0;
+    unsigned char* converted = convertToLayout50(data, dataSize, newSize);
+#ifndef _WIN32
+    if (mapped) munmap(data, dataSize);
+#endif
+    if (!mapped) freeMemory(data, dataSize);
+    data     = converted;
+    dataSize = newSize;
+    mapped   = false;
+  }
+
+  // the position of each message type, -1 for unknown types
+  int positions[256];
+  std::fill(positions, positions + 256, -1);
+  for (unsigned long long i = 0; i < ITCH::TYPES.size(); ++i) positions[ITCH::TYPES[i]] = i;
+
+  typeOffsets.assign(ITCH::TYPES.size(), Column<unsigned long long>());
+
+  // the first message starts after its 2 byte length
+  unsigned long long idx = 2;
+  unsigned long long nMessages = 0;
+  while (idx < dataSize) {
+    const unsigned char type = data[idx];
+    const unsigned long long thisMsgLength = getMessageLength(type);
+    // a truncated message at the end of the file
+    if (idx + thisMsgLength > dataSize) break;
+
+    if (positions[type] >= 0) typeOffsets[positions[type]].push_back(idx);
+
+    // two empty strings after each message...
+    idx += thisMsgLength + 2;
+    if ((++nMessages & 0xFFFFF) == 0) Rcpp::checkUserInterrupt();
+  }
+
+  locateOffsets.assign(ITCH::TYPES.size(), std::unordered_map<int, Column<unsigned long long>>());
+  locatesSplit.assign(ITCH::TYPES.size(), false);
+  framed = true;
+}
+
+/**
+ * @brief      Splits the offsets of one message type by the stock locate,
+ *              only done on the first call for each type
+ *
+ * @param[in]  typePos  The position of the message type (see ITCH::POS)
+ */
+void ITCHSession::splitByLocate(int typePos) {
+  if (locatesSplit[typePos]) return;
+
+  std::unordered_map<int, Column<unsigned long long>>& split = locateOffsets[typePos];
+  split.clear();
+  // the stock locate follows the message type in all messages
+  for (unsigned long long offset : typeOffsets[typePos]) {
+    split[get2bytes(&data[offset + 1])].push_back(offset);
+  }
+  locatesSplit[typePos] = true;
+}
+
+/**
+ * @brief      Counts the messages of the file by type
+ *
+ * @return     A vector containing the number of messages per type
+ */
+std::vector<unsigned long long> ITCHSession::countMessages() {
+  if (!open) Rcpp::stop("The session is closed");
+  frame();
+
+  std::vector<unsigned long long> count(ITCH::TYPES.size(), 0);
+  for (unsigned long long i = 0; i < count.size(); ++i) count[i] = typeOffsets[i].size();
+  return count;
+}
+
+/**
+ * @brief      Loads the messages from the session into a MessageType, the messages
+ *              of all valid types (and selected stocks) are merged in the order of the file
+ *
+ * @param      msg            The messagetype, or a subtype of it, which holds the information
+ * @param[in]  startMsgCount  The start message count, the message count at which we
+ *                              start to save the messages
+ * @param[in]  endMsgCount    The end message count, the message count at which we
+ *                              stop to save the messages
+ * @param[in]  filter         The filter of the messages (by stock, market session, and trading state),
+ *                              the message counts refer to the messages that pass the filter
+ */
+void ITCHSession::loadToMessages(MessageType& msg,
+                                 unsigned long long startMsgCount,
+                                 unsigned long long endMsgCount,
+                                 MessageFilter filter) {
+  if (!open) Rcpp::stop("The session is closed");
+  frame();
+  msg.setBoundaries(startMsgCount, endMsgCount);
+  
+  const std::vector<int> locates = filter.getLocates();
+  // the part of the file that belongs to the market session
+  unsigned long long beginOffset = 0, endOffset = dataSize;
+  filter.getRange(data, typeOffsets[ITCH::POS::S], beginOffset, endOffset);
+  filter.ignoreMarketSession();
+
+  // the offset lists that hold the requested messages
+  std::vector<const Column<unsigned long long>*> lists;
+  for (unsigned char type : msg.validTypes) {
+    const int typePos = getMessagePosition(type);
+    if (locates.empty()) {
+      lists.push_back(&typeOffsets[typePos]);
+      continue;
+    }
+    splitByLocate(typePos);
+    for (int locate : locates) {
+      auto it = locateOffsets[typePos].find(locate);
+      if (it != locateOffsets[typePos].end()) lists.push_back(&it->second);
+    }
+  }
+
+  // the first and the last message of each list in the market session
+  std::vector<unsigned long long> heads(lists.size()), tails(lists.size());
+  unsigned long long total = 0;
+  for (unsigned long long i = 0; i < lists.size(); ++i) {
+    heads[i] = std::lower_bound(lists[i]->begin(), lists[i]->end(), beginOffset) - lists[i]->begin();
+    tails[i] = std::lower_bound(lists[i]->begin(), lists[i]->end(), endOffset)   - lists[i]->begin();
+    if (tails[i] < heads[i]) tails[i] = heads[i];
+    total += tails[i] - heads[i];
+  }
+  unsigned long long nMessages = total > startMsgCount ? total - startMsgCount : 0;
+  if (endMsgCount != std::numeric_limits<unsigned long long>::max() && 
+      endMsgCount - startMsgCount + 1 < nMessages) nMessages = endMsgCount - startMsgCount + 1;
+  msg.reserve(nMessages);
+
+  // a single list can start directly at the first requested message,
+  // unless dropped messages would be counted
+  if (lists.size() == 1 && filter.getTradingMode() != TRADING_DROP) {
+    const unsigned long long skip = std::min(startMsgCount, total);
+    heads[0] += skip;
+    msg.messageCount = skip;
+  }
+
+  // the trading state is tracked from all trading actions before the end of the market session,
+  // they are merged with the other messages but not loaded
+  if (filter.getTradingMode() != TRADING_KEEP) {
+    const Column<unsigned long long>& actions = typeOffsets[ITCH::POS::H];
+    lists.push_back(&actions);
+    heads.push_back(0);
+    tails.push_back(std::lower_bound(actions.begin(), actions.end(), endOffset) - actions.begin());
+  }
+
+  // merge the lists by their offset, thus the messages are loaded in the order of the file,
+  // a min-heap holds the next offset of each list (O(log L) per message for L lists)
+  typedef std::pair<unsigned long long, unsigned long long> Head; // the offset and the list
+  std::vector<Head> heap;
+  heap.reserve(lists.size());
+  for (unsigned long long i = 0; i < lists.size(); ++i) {
+    if (heads[i] < tails[i]) heap.push_back(Head((*lists[i])[heads[i]], i));
+  }
+  std::make_heap(heap.begin(), heap.end(), std::greater<Head>());
+
+  unsigned long long nLoaded = 0;
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), std::greater<Head>());
+    const unsigned long long nextOffset = heap.back().first;
+    const unsigned long long next       = heap.back().second;
+    if (++heads[next] < tails[next]) {
+      heap.back().first = (*lists[next])[heads[next]];
+      std::push_heap(heap.begin(), heap.end(), std::greater<Head>());
+    } else {
+      heap.pop_back();
+    }
+
+    // false if the endMsgCount has been reached, no need to continue
+    if (!filter.load(msg, &data[nextOffset])) break;
+    if ((++nLoaded & 0xFFFFF) == 0) Rcpp::checkUserInterrupt();
+  }
+  msg.finish();
+}
+
+/**
+ * @brief      Returns the session of an external pointer
+ *
+ * @param[in]  session  The external pointer as returned by openSession_impl
+ *
+ * @return     The session
+ */
+static ITCHSession* getSession(SEXP session) {
+  Rcpp::XPtr<ITCHSession> ptr(session);
+  if (ptr.get() == NULL) Rcpp::stop("The session is not valid");
+  return ptr.get();
+}
+
+/**
+ * @brief      Loads the messages from a session into the given messagetype (i.e., Trades, Orders, etc)
+ *
+ * @param      msg            The given messagetype (i.e., Trades, Orders, etc)
+ * @param[in]  session        The external pointer to the session
+ * @param[in]  startMsgCount  The start message count, defaults to 0 (first message)
+ * @param[in]  endMsgCount    The end message count, 0 is substituted to all messages
+ * @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+ * @param[in]  marketSession  The market session to load (see MarketSession)
+ * @param[in]  tradingMode    The use of the trading state (see TradingStateMode)
+ * @param[in]  quiet          If true, no status message is printed
+ * @param[in]  arrow          If true, the data is moved into an Arrow stream (see ArrowBuilder)
+ *
+ * @return     A Rcpp::DataFrame containing the data, or an external pointer to the Arrow stream
+ */
+Rcpp::RObject getSessionMessagesTemplate(MessageType& msg,
+                                         SEXP session,
+                                         unsigned long long startMsgCount,
+                                         unsigned long long endMsgCount,
+                                         Rcpp::IntegerVector stockLocate,
+                                         int marketSession,
+                                         int tradingMode,
+                                         bool quiet,
+                                         bool arrow) {
+  ITCHSession* s = getSession(session);
+
+  // check that the order is correct
+  if (startMsgCount > endMsgCount) std::swap(startMsgCount, endMsgCount);
+  if (endMsgCount == 0ULL) endMsgCount = std::numeric_limits<unsigned long long>::max();
+
+  const MessageFilter filter = MessageFilter::create(stockLocate, marketSession, tradingMode);
+  msg.tagTradingState = tradingMode == TRADING_TAG;
+
+  if (!quiet && !s->isFramed()) {
+    Rcpp::Rcout << "[Framing]    ";
+    std::vector<unsigned long long> count = s->countMessages();
+    Rcpp::Rcout << msg.countValidMessages(count) << " messages found\n";
+  }
+
+  if (!quiet) Rcpp::Rcout << "[Loading]    from session";
+  s->loadToMessages(msg, startMsgCount, endMsgCount, filter);
+
+  if (!quiet) Rcpp::Rcout << "\n[Converting] to " << (arrow ? "Arrow" : "data.table") << "\n";
+  if (arrow) return msg.getArrow();
+  return msg.getDF();
+}
+
+
+// @brief      Opens a session, which keeps a file in memory for repeated queries
+//
+// @param[in]  filename  The filename to a plain-text-file
+//
+// @return     An external pointer to the session
+//
+// [[Rcpp::export]]
+SEXP openSession_impl(std::string filename) {
+  Rcpp::XPtr<ITCHSession> ptr(new ITCHSession(filename), true);
+  return ptr;
+}
+
+// @brief      Closes a session and releases its memory
+//
+// @param[in]  session  The external pointer to the session
+//
+// [[Rcpp::export]]
+void closeSession_impl(SEXP session) {
+  getSession(session)->close();
+}
+
+// @brief      Returns information about a session
+//
+// @param[in]  session  The external pointer to the session
+//
+// @return     A list containing the file, its size in bytes, and if the session is open,
+//              mapped into memory, and framed
+//
+// [[Rcpp::export]]
+Rcpp::List getSessionInfo_impl(SEXP session) {
+  ITCHSession* s = getSession(session);
+  return Rcpp::List::create(
+    Rcpp::Named("file")   = s->file(),
+    Rcpp::Named("bytes")  = (double) s->size(),
+    Rcpp::Named("open")   = s->isOpen(),
+    Rcpp::Named("mapped") = s->isMapped(),
+    Rcpp::Named("framed") = s->isFramed()
+  );
+}
+
+// @brief      Counts the messages of a session by type
+//
+// @param[in]  session  The external pointer to the session
+// @param[in]  quiet    If true, no status message is printed
+//
+// @return     An Rcpp::DataFrame containing the message type and the count
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame getSessionCountDF_impl(SEXP session, bool quiet) {
+  ITCHSession* s = getSession(session);
+
+  if (!quiet) Rcpp::Rcout << (s->isFramed() ? "[Counting]   " : "[Framing]    ");
+  std::vector<unsigned long long> count = s->countMessages();
+  unsigned long long nMessages = 0ULL;
+  for (unsigned long long i : count) {
+    nMessages += i;
+  }
+  if (!quiet) Rcpp::Rcout << nMessages << " messages found\n";
+  if (!quiet) Rcpp::Rcout << "[Converting] to data.table\n";
+
+  Rcpp::StringVector types(ITCH::TYPES.size());
+  types = ITCH::TYPESSTRING;
+
+  Rcpp::DataFrame df = Rcpp::DataFrame::create(Rcpp::Named("msg_type") = types,
+                                               Rcpp::Named("count") = count);
+  return df;
+}
+
+// @brief      Returns the Orders ('A' and 'F') from a session as a dataframe
+//
+// @param[in]  session        The external pointer to the session
+// @param[in]  startMsgCount  The start message count, defaults to 0 (first message)
+// @param[in]  endMsgCount    The end message count, 0 is substituted to all messages
+// @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+// @param[in]  marketSession  The market session to load, 0 all, 1 pre-market, 2 regular, 3 post-market
+// @param[in]  tradingMode    The use of the trading state, 0 keep, 1 tag, 2 drop halted/paused/quoted stocks
+// @param[in]  arrow          If true, the orders are returned as an Arrow stream
+// @param[in]  quiet          If true, no status message is printed
+//
+// @return     The orders in a data.frame, or an external pointer to the Arrow stream
+//
+// [[Rcpp::export]]
+Rcpp::RObject getSessionOrders_impl(SEXP session,
+                                    unsigned long long startMsgCount,
+                                    unsigned long long endMsgCount,
+                                    Rcpp::IntegerVector stockLocate,
+                                    int marketSession,
+                                    int tradingMode,
+                                    bool arrow,
+                                    bool quiet) {
+  Orders orders;
+  return getSessionMessagesTemplate(orders, session, startMsgCount, endMsgCount, 
+                                    stockLocate, marketSession, tradingMode, quiet, arrow);
+}
+
+// @brief      Returns the Trades ('P', 'Q', and 'B') from a session as a dataframe
+//
+// @param[in]  session        The external pointer to the session
+// @param[in]  startMsgCount  The start message count, defaults to 0 (first message)
+// @param[in]  endMsgCount    The end message count, 0 is substituted to all messages
+// @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+// @param[in]  marketSession  The market session to load, 0 all, 1 pre-market, 2 regular, 3 post-market
+// @param[in]  tradingMode    The use of the trading state, 0 keep, 1 tag, 2 drop halted/paused/quoted stocks
+// @param[in]  brokenMode     The use of the broken trades, 0 keep, 1 flag, 2 drop the broken trades
+// @param[in]  arrow          If true, the trades are returned as an Arrow stream
+// @param[in]  quiet          If true, no status message is printed
+//
+// @return     The trades in a data.frame, or an external pointer to the Arrow stream
+//
+// [[Rcpp::export]]
+Rcpp::RObject getSessionTrades_impl(SEXP session,
+                                    unsigned long long startMsgCount,
+                                    unsigned long long endMsgCount,
+                                    Rcpp::IntegerVector stockLocate,
+                                    int marketSession,
+                                    int tradingMode,
+                                    int brokenMode,
+                                    bool arrow,
+                                    bool quiet) {
+  Trades trades(checkBrokenMode(brokenMode));
+  return getSessionMessagesTemplate(trades, session, startMsgCount, endMsgCount, 
+                                    stockLocate, marketSession, tradingMode, quiet, arrow);
+}
+
+// @brief      Returns the Modifications ('E', 'C', 'X', 'D', and 'U') from a session as a dataframe
+//
+// @param[in]  session        The external pointer to the session
+// @param[in]  startMsgCount  The start message count, defaults to 0 (first message)
+// @param[in]  endMsgCount    The end message count, 0 is substituted to all messages
+// @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+// @param[in]  marketSession  The market session to load, 0 all, 1 pre-market, 2 regular, 3 post-market
+// @param[in]  tradingMode    The use of the trading state, 0 keep, 1 tag, 2 drop halted/paused/quoted stocks
+// @param[in]  arrow          If true, the modifications are returned as an Arrow stream
+// @param[in]  quiet          If true, no status message is printed
+//
+// @return     The modifications in a data.frame, or an external pointer to the Arrow stream
+//
+// [[Rcpp::export]]
+Rcpp::RObject getSessionModifications_impl(SEXP session,
+                                           unsigned long long startMsgCount,
+                                           unsigned long long endMsgCount,
+                                           Rcpp::IntegerVector stockLocate,
+                                           int marketSession,
+                                           int tradingMode,
+                                           bool arrow,
+                                           bool quiet) {
+  Modifications mods;
+  return getSessionMessagesTemplate(mods, session, startMsgCount, endMsgCount, 
+                                    stockLocate, marketSession, tradingMode, quiet, arrow);
+}
@@ -0,0 +1,75 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <Rcpp.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "RITCH.h"
+#include "Memory.h"
+#include "MessageFilter.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * An ITCHSession keeps a file open for repeated queries (see open_itch()).
+ *
+ * The file is mapped into memory once, the framing (the offset of each
+ *  message, split by message type) is done lazily on the first query,
+ *  an ITCH 4.1 file is converted into the ITCH 5.0 layout before (see Layout.h).
+ *  The offsets of a message type are split by stock locate the first time
+ *  a query selects some stocks. A market session (see MessageFilter) is found
+ *  from the system events. Later queries only touch the messages they load.
+ * #################################################################
+ */
+
+class ITCHSession {
+public:
+  explicit ITCHSession(std::string filename);
+  ~ITCHSession();
+  ITCHSession(ITCHSession const&) = delete;
+  void operator=(ITCHSession const&) = delete;
+
+  // Functions
+  void close();
+  bool isOpen() const { return open; }
+  bool isFramed() const { return framed; }
+  bool isMapped() const { return mapped; }
+  std::string file() const { return filename; }
+  unsigned long long size() const { return dataSize; }
+  std::vector<unsigned long long> countMessages();
+  void loadToMessages(MessageType& msg,
+                      unsigned long long startMsgCount,
+                      unsigned long long endMsgCount,
+                      MessageFilter filter);
+
+private:
+  void frame();
+  void splitByLocate(int typePos);
+
+  // Members
+  std::string filename;
+  unsigned char* data = NULL;
+  unsigned long long dataSize = 0;
+  bool open   = false;
+  bool mapped = false; // true if mmapped, otherwise the file was read into memory
+  bool framed = false;
+  // the offsets of the messages (the message type byte) by the position of their type
+  std::vector<Column<unsigned long long>> typeOffsets;
+  // the offsets by the position of their type and their stock locate, split on first use
+  std::vector<std::unordered_map<int, Column<unsigned long long>>> locateOffsets;
+  std::vector<bool> locatesSplit;
+};
+
+// loads the messages from a session (an external pointer) into the messagetype
+Rcpp::RObject getSessionMessagesTemplate(MessageType& msg,
+                                         SEXP session,
+                                         unsigned long long startMsgCount,
+                                         unsigned long long endMsgCount,
+                                         Rcpp::IntegerVector stockLocate,
+                                         int marketSession,
+                                         int tradingMode,
+                                         bool quiet,
+                                         bool arrow = false);
+
+#endif //SESSION_H
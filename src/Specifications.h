@@ -62,10 +62,63 @@ namespace ITCH {
     const int I = 19;
     const int N = 20;
   }
+  // the event codes of the system event messages ('S')
+  namespace EVENT {
+    const unsigned char START_MESSAGES = 'O';
+    const unsigned char START_SYSTEM   = 'S';
+    const unsigned char START_MARKET   = 'Q';
+    const unsigned char END_MARKET     = 'M';
+    const unsigned char END_SYSTEM     = 'E';
+    const unsigned char END_MESSAGES   = 'C';
+  }
+  // the trading states of the stock trading action messages ('H')
+  namespace TRADING {
+    const unsigned char HALTED    = 'H';
+    const unsigned char PAUSED    = 'P';
+    const unsigned char QUOTATION = 'Q';
+    const unsigned char TRADING   = 'T';
+  }
+
+  // the levels of the cross types of the cross trade messages ('Q')
+  const std::vector<unsigned char> CROSS_TYPES = {'O','C','H','I'};
+  // the levels of the trading states (see TRADING)
+  const std::vector<unsigned char> TRADING_STATES = {'H','P','Q','T'};
+
   // all messages in a string, to make conversions easier
   const std::vector<std::string> TYPESSTRING = {"S","R","H","Y","L","V","W","K","J",
                                                 "A","F","E", "C","X","D","U","P","Q",
                                                 "B","I","N"};
 }
 
+/**
+ * The specifications of ITCH 4.1, the messages have no stock locate and
+ * tracking number, the timestamp holds the nanoseconds (4 bytes) of the
+ * second of the last time message ('T'). The fields after the timestamp
+ * are those of ITCH 5.0, the stock directory ('R') misses the fields
+ * after the round lots only flag (see Layout.h)
+ */
+namespace ITCH41 {
+  // the size in bytes of each message
+  namespace SIZE {
+    const unsigned long long T = 5;
+    const unsigned long long S = 6;
+    const unsigned long long R = 20;
+    const unsigned long long H = 19;
+    const unsigned long long Y = 14;
+    const unsigned long long L = 20;
+    const unsigned long long A = 30;
+    const unsigned long long F = 34;
+    const unsigned long long E = 25;
+    const unsigned long long C = 30;
+    const unsigned long long X = 17;
+    const unsigned long long D = 13;
+    const unsigned long long U = 29;
+    const unsigned long long P = 38;
+    const unsigned long long Q = 34;
+    const unsigned long long B = 13;
+    const unsigned long long I = 44;
+    const unsigned long long N = 14;
+  }
+}
+
 #endif //SPECIFICATIONS_H
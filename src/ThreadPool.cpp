@@ -0,0 +1,355 @@
+#include "ThreadPool.h"
+#include "Numa.h"
+#include <cstdlib>
+#include <algorithm>
+#include <exception>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// true for the threads that are owned by the pool, nested parallelFor calls are run serially
+static thread_local bool inWorker = false;
+
+/**
+ * @brief      Returns the CPUs this process is allowed to run on (respects taskset/cgroups)
+ *
+ * @return     The ids of the allowed CPUs, empty if unknown
+ */
+static std::vector<int> allowedCPUs() {
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int i = 0; i < CPU_SETSIZE; ++i) {
+      if (CPU_ISSET(i, &set)) cpus.push_back(i);
+    }
+  }
+#endif
+  return cpus;
+}
+
+// the pool of this process, a forked child gets a new pool (see childAfterFork),
+// the pool is destroyed (its workers are joined) when the library is unloaded
+struct PoolHolder {
+  ThreadPool* pool = NULL;
+  ~PoolHolder() { delete pool; }
+};
+static PoolHolder current;
+
+/**
+ * @brief      Returns the single instance of the pool, the pool is created on first use.
+ *              A forked child has its own pool, thus the reference is not kept across calls
+ *
+ * @return     The thread pool
+ */
+ThreadPool& ThreadPool::instance() {
+  if (current.pool == NULL) {
+    current.pool = new ThreadPool(defaultThreads());
+#ifndef _WIN32
+    pthread_atfork(&ThreadPool::prepareFork, &ThreadPool::parentAfterFork, &ThreadPool::childAfterFork);
+#endif
+  }
+  return *current.pool;
+}
+
+ThreadPool::ThreadPool(unsigned int threads) : nThreads(threads), threadStats(nThreads) {}
+
+ThreadPool::~ThreadPool() {
+  stop();
+}
+
+/**
+ * @brief      The default number of threads: all allowed CPUs, limited by OMP_THREAD_LIMIT
+ *
+ * @return     The default number of threads
+ */
+unsigned int ThreadPool::defaultThreads() {
+  unsigned int n = std::thread::hardware_concurrency();
+  std::vector<int> cpus = allowedCPUs();
+  if (!cpus.empty() && cpus.size() < n) n = cpus.size();
+
+  const char* limit = std::getenv("OMP_THREAD_LIMIT");
+  if (limit != NULL && std::atoi(limit) > 0 && (unsigned int) std::atoi(limit) < n) {
+    n = std::atoi(limit);
+  }
+  return n == 0 ? 1 : n;
+}
+
+/**
+ * @brief      Sets the number of threads, running workers are stopped and
+ *              restarted lazily with the new settings
+ *
+ * @param[in]  threads  The number of threads (including the main thread), 0 uses the default
+ * @param[in]  pin      If true, the worker threads are pinned to the allowed CPUs
+ */
+void ThreadPool::setThreads(unsigned int threads, bool pin) {
+  if (threads == 0) threads = defaultThreads();
+  if (threads == nThreads && pin == this->pin) return;
+  stop();
+  nThreads  = threads;
+  this->pin = pin;
+  threadStats.assign(nThreads, ThreadStats());
+}
+
+/**
+ * @brief      Starts the worker threads, the main thread counts as one of the threads
+ */
+void ThreadPool::start() {
+  if (running) return;
+  shutdown = false;
+  // all workers are created before the threads start, their addresses do not change
+  workers.reset(new std::vector<Worker>(nThreads - 1));
+  for (unsigned int id = 1; id < nThreads; ++id) {
+    (*workers)[id - 1].thread = std::thread(&ThreadPool::workerLoop, this, id);
+  }
+  running = true;
+}
+
+/**
+ * @brief      Stops and joins all worker threads
+ */
+void ThreadPool::stop() {
+  if (!running) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shutdown = true;
+  }
+  taskCV.notify_all();
+  for (Worker& worker : *workers) worker.thread.join();
+  workers.reset();
+  running = false;
+}
+
+/**
+ * @brief      Chooses the CPU of a pinned worker, the workers are distributed 
+ *              round-robin over the NUMA nodes (and over the CPUs within a node)
+ *
+ * @param[in]  id    The id of the worker (1 to threads - 1)
+ *
+ * @return     The CPU id, -1 if no CPU is available
+ */
+int ThreadPool::chooseCPU(unsigned int id) const {
+  std::vector<int> allowed = allowedCPUs();
+  if (allowed.empty()) return -1;
+
+  // the allowed CPUs of each node
+  std::vector<std::vector<int>> nodes;
+  for (int node : getNumaNodes()) {
+    std::vector<int> cpus;
+    for (int cpu : getNumaCPUs(node)) {
+      if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) cpus.push_back(cpu);
+    }
+    if (!cpus.empty()) nodes.push_back(cpus);
+  }
+  if (nodes.empty()) return allowed[id % allowed.size()];
+
+  const std::vector<int>& cpus = nodes[(id - 1) % nodes.size()];
+  return cpus[((id - 1) / nodes.size()) % cpus.size()];
+}
+
+/**
+ * @brief      The loop of a worker thread, waits for tasks in its queue and executes them
+ *
+ * @param[in]  id    The id of the worker (1 to threads - 1)
+ */
+void ThreadPool::workerLoop(unsigned int id) {
+  inWorker = true;
+
+#ifdef __linux__
+  if (pin) {
+    const int cpu = chooseCPU(id);
+    if (cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+  }
+#endif
+
+  Worker& worker = (*workers)[id - 1];
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      taskCV.wait(lock, [&] { return shutdown || !worker.tasks.empty(); });
+      if (shutdown && worker.tasks.empty()) return;
+      task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+    }
+    task();
+  }
+}
+
+/**
+ * @brief      Records a processed chunk in the statistics of a thread,
+ *              only called by the thread itself
+ *
+ * @param[in]  id        The id of the thread (0 is the main thread)
+ * @param[in]  elements  The number of elements in the chunk
+ */
+void ThreadPool::recordChunk(unsigned int id, unsigned long long elements) {
+  ThreadStats& stats = threadStats[id];
+  stats.cpu  = getCurrentCPU();
+  stats.node = getNumaNode(stats.cpu);
+  ++stats.chunks;
+  stats.elements += elements;
+}
+
+/**
+ * @brief      Called before a fork (i.e., parallel::mclapply), the lock is held
+ *              during the fork, thus no worker holds it in the child
+ */
+void ThreadPool::prepareFork() {
+  if (current.pool != NULL) current.pool->mutex.lock();
+}
+
+/**
+ * @brief      Called in the parent process after a fork, releases the lock
+ */
+void ThreadPool::parentAfterFork() {
+  if (current.pool != NULL) current.pool->mutex.unlock();
+}
+
+/**
+ * @brief      Called in the child process after a fork, the worker threads do not exist
+ *              in the child, thus the child gets a new pool with a single thread,
+ *              unless set_threads() is called in the child. The pool of the parent is
+ *              abandoned, not destroyed, as its workers cannot be joined in the child
+ */
+void ThreadPool::childAfterFork() {
+  if (current.pool != NULL) current.pool = new ThreadPool(1);
+}
+
+/**
+ * @brief      Runs fun over the range [0, n), split into contiguous chunks that are
+ *              processed by the worker threads and the calling thread.
+ *              Chunk i is always processed by thread i, thus repeated calls over the 
+ *              same data touch the same memory from the same (NUMA-)node.
+ *              Blocks until all chunks are done, exceptions are rethrown on the calling thread.
+ *
+ *              fun must not call the R API!
+ *
+ * @param[in]  n      The size of the range
+ * @param[in]  grain  The minimum number of elements per chunk
+ * @param[in]  fun    The function that is called for each chunk as fun(begin, end)
+ */
+void ThreadPool::parallelFor(unsigned long long n,
+                             unsigned long long grain,
+                             const std::function<void(unsigned long long, unsigned long long)>& fun) {
+  if (n == 0) return;
+  if (grain == 0) grain = 1;
+
+  unsigned long long nChunks = (n + grain - 1) / grain;
+  if (nChunks > nThreads) nChunks = nThreads;
+
+  if (nChunks <= 1 || inWorker) {
+    fun(0, n);
+    return;
+  }
+
+  start();
+
+  const unsigned long long chunkSize = (n + nChunks - 1) / nChunks;
+  unsigned long long remaining = nChunks - 1;
+  std::exception_ptr error;
+  std::mutex doneMutex;
+  std::condition_variable doneCV;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (unsigned long long chunk = 1; chunk < nChunks; ++chunk) {
+      const unsigned long long begin = chunk * chunkSize;
+      const unsigned long long end   = std::min(n, begin + chunkSize);
+      const unsigned int id = chunk;
+      (*workers)[id - 1].tasks.push_back([&, begin, end, id] {
+        std::exception_ptr e;
+        try {
+          if (begin < end) fun(begin, end);
+          recordChunk(id, end > begin ? end - begin : 0);
+        } catch (...) {
+          e = std::current_exception();
+        }
+        std::lock_guard<std::mutex> doneLock(doneMutex);
+        if (e) error = e;
+        if (--remaining == 0) doneCV.notify_one();
+      });
+    }
+  }
+  taskCV.notify_all();
+
+  // the calling thread takes the first chunk
+  std::exception_ptr mainError;
+  try {
+    fun(0, std::min(n, chunkSize));
+    recordChunk(0, std::min(n, chunkSize));
+  } catch (...) {
+    mainError = std::current_exception();
+  }
+
+  std::unique_lock<std::mutex> doneLock(doneMutex);
+  doneCV.wait(doneLock, [&] { return remaining == 0; });
+
+  if (mainError) std::rethrow_exception(mainError);
+  if (error) std::rethrow_exception(error);
+}
+
+
+// @brief      Sets the number of threads used by the package
+//
+// @param[in]  threads  The number of threads, 0 uses the default
+// @param[in]  pin      If true, the worker threads are pinned to CPUs
+//
+// @return     The number of threads
+//
+// [[Rcpp::export]]
+int setThreads_impl(int threads, bool pin) {
+  if (threads < 0) Rcpp::stop("threads has to be non-negative");
+  ThreadPool::instance().setThreads(threads, pin);
+  return ThreadPool::instance().threads();
+}
+
+// @brief      Returns the number of threads used by the package
+//
+// @return     A list containing the number of threads, if they are pinned, and the default
+//
+// [[Rcpp::export]]
+Rcpp::List getThreads_impl() {
+  ThreadPool& pool = ThreadPool::instance();
+  return Rcpp::List::create(
+    Rcpp::Named("threads") = (int) pool.threads(),
+    Rcpp::Named("pinned")  = pool.pinned(),
+    Rcpp::Named("default") = (int) ThreadPool::defaultThreads()
+  );
+}
+
+// @brief      Returns the statistics of each thread of the pool
+//
+// @return     A data.frame with the thread id (0 is the main thread), the last CPU and 
+//              NUMA node it ran on, and the number of chunks and elements it processed
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame getThreadStats_impl() {
+  std::vector<ThreadStats> stats = ThreadPool::instance().stats();
+  std::vector<int> thread, cpu, node;
+  std::vector<double> chunks, elements;
+  for (unsigned long long i = 0; i < stats.size(); ++i) {
+    thread.push_back(i);
+    cpu.push_back(stats[i].cpu);
+    node.push_back(stats[i].node);
+    chunks.push_back(stats[i].chunks);
+    elements.push_back(stats[i].elements);
+  }
+  return Rcpp::DataFrame::create(
+    Rcpp::Named("thread")   = thread,
+    Rcpp::Named("cpu")      = cpu,
+    Rcpp::Named("node")     = node,
+    Rcpp::Named("chunks")   = chunks,
+    Rcpp::Named("elements") = elements
+  );
+}
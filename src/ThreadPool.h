@@ -0,0 +1,87 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <Rcpp.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * A package-level thread pool, which is shared by all parallel parts
+ *  of the package (i.e., the conversion of the parsed vectors in getDF)
+ *
+ * The worker threads never touch the R API, all allocations of R objects
+ *  have to be done on the main thread before the work is distributed.
+ *
+ * The number of threads can be set from R (see set_threads()), the
+ *  default does not oversubscribe forked processes
+ *  (i.e., parallel::mclapply workers use a single thread)
+ *
+ * Each chunk of a parallelFor is always given to the same worker, pinned
+ *  workers are spread over the NUMA nodes, thus the memory a worker 
+ *  touches first is placed on its local node (see Numa.h)
+ * #################################################################
+ */
+
+// the statistics of one thread of the pool (0 is the main thread)
+struct ThreadStats {
+  int cpu  = -1;
+  int node = 0;
+  unsigned long long chunks   = 0;
+  unsigned long long elements = 0;
+};
+
+class ThreadPool {
+public:
+  static ThreadPool& instance();
+
+  // Functions
+  void setThreads(unsigned int threads, bool pin);
+  unsigned int threads() const { return nThreads; }
+  bool pinned() const { return pin; }
+  std::vector<ThreadStats> stats() const { return threadStats; }
+  void parallelFor(unsigned long long n,
+                   unsigned long long grain,
+                   const std::function<void(unsigned long long, unsigned long long)>& fun);
+
+  static unsigned int defaultThreads();
+
+private:
+  explicit ThreadPool(unsigned int threads);
+  ~ThreadPool();
+  ThreadPool(ThreadPool const&) = delete;
+  void operator=(ThreadPool const&) = delete;
+  friend struct PoolHolder;
+
+  struct Worker {
+    std::thread thread;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void start();
+  void stop();
+  void workerLoop(unsigned int id);
+  int chooseCPU(unsigned int id) const;
+  void recordChunk(unsigned int id, unsigned long long elements);
+  static void prepareFork();
+  static void parentAfterFork();
+  static void childAfterFork();
+
+  // Members
+  unsigned int nThreads;
+  bool pin = false;
+  bool running = false;
+  bool shutdown = false;
+  std::unique_ptr<std::vector<Worker>> workers;
+  std::vector<ThreadStats> threadStats;
+  std::mutex mutex;
+  std::condition_variable taskCV;
+};
+
+#endif //THREADPOOL_H
@@ -0,0 +1,138 @@
+#include "TradeQuotes.h"
+#include "BookSnapshot.h"
+#include "DataFrameBuilder.h"
+#include "RITCH.h"
+#include "Session.h"
+
+/**
+ * @brief      Applies a message to the book, executions are added with the
+ *              top of book before they are applied
+ *
+ * @param      buf   The buffer
+ */
+void TradeQuotes::onApply(unsigned char* buf) {
+  switch (buf[0]) {
+  case 'P': {
+    // a non-displayed trade is not in the book, the message gives the side and the price
+    const BookOrder order{get2bytes(&buf[1]), buf[19] == 'B', get4bytes(&buf[32]), get4bytes(&buf[20]),
+                          NO_ORDER, NO_ORDER};
+    addExecution(buf, order, get8bytes(&buf[11]), get8bytes(&buf[36]), order.shares, order.price);
+    return;
+  }
+  case 'E':
+  case 'C': {
+    const unsigned long long ref = get8bytes(&buf[11]);
+    const BookOrder* order = book.find(ref);
+    if (order != NULL) {
+      const unsigned int execPrice = buf[0] == 'C' ? get4bytes(&buf[32]) : order->price;
+      addExecution(buf, *order, ref, get8bytes(&buf[23]), get4bytes(&buf[19]), execPrice);
+    }
+    break;
+  }
+  }
+  book.update(buf);
+}
+
+/**
+ * @brief      Adds an execution with the current top of book of its stock
+ *
+ * @param      buf          The buffer
+ * @param[in]  order        The resting order (or the trade for 'P' messages)
+ * @param[in]  ref          The order reference number
+ * @param[in]  match        The match number
+ * @param[in]  execShares   The executed shares
+ * @param[in]  execPrice    The execution price in 1e-4 dollars
+ */
+void TradeQuotes::addExecution(unsigned char* buf, BookOrder const& order, unsigned long long ref,
+                               unsigned long long match, unsigned long long execShares, unsigned int execPrice) {
+  const TopOfBook quote = book.top(order.locateCode);
+
+  type.push_back(           buf[0] );
+  locateCode.push_back(     order.locateCode );
+  trackingNumber.push_back( get2bytes(&buf[3]) );
+  timestamp.push_back(      get6bytes(&buf[5]) );
+  orderRef.push_back(       ref );
+  matchNumber.push_back(    match );
+  stock.push_back(          order.locateCode < stocks.size() ? stocks[order.locateCode] : 0ULL );
+  buy.push_back(            order.buy );
+  shares.push_back(         execShares );
+  price.push_back(          (double) execPrice / 10000.0 );
+  bidPrice.push_back(       quote.bidPrice == 0 ? NA_REAL : (double) quote.bidPrice / 10000.0 );
+  bidShares.push_back(      quote.bidShares );
+  askPrice.push_back(       quote.askPrice == 0 ? NA_REAL : (double) quote.askPrice / 10000.0 );
+  askShares.push_back(      quote.askShares );
+}
+
+/**
+ * @brief      Converts the executions into an Rcpp::DataFrame,
+ *              the numeric columns are filled in parallel
+ *
+ * @return     The Rcpp::DataFrame
+ */
+Rcpp::DataFrame TradeQuotes::getDF() {
+
+  DataFrameBuilder df(type.size());
+  df.addFactor( "msg_type",        type, {'E', 'C', 'P'}); // the executions only
+  df.addNumeric("locate_code",     locateCode);
+  df.addNumeric("tracking_number", trackingNumber);
+  df.addNumeric("timestamp",       timestamp);
+  df.addNumeric("order_ref",       orderRef);
+  df.addNumeric("match_number",    matchNumber);
+  df.addSymbol( "stock",           stock);
+  df.addLogical("buy",             buy);
+  df.addNumeric("shares",          shares);
+  df.addNumeric("price",           price);
+  df.addNumeric("bid_price",       bidPrice);
+  df.addNumeric("bid_shares",      bidShares);
+  df.addNumeric("ask_price",       askPrice);
+  df.addNumeric("ask_shares",      askShares);
+
+  return df.build();
+}
+
+
+// @brief      Returns the executions ('E', 'C', and 'P') of a file with the top of book
+//              of their stock before the execution as a dataframe
+//
+// @param[in]  filename     The filename to a plain-text-file, "-" for stdin, or "| cmd"
+// @param[in]  bufferSize   The buffer size in bytes, 0 chooses the size automatically
+// @param[in]  stockLocate  The stock locate codes to load, empty for all stocks
+// @param[in]  bookFile     The book file whose last snapshot seeds the book, empty for an empty book
+// @param[in]  quiet        If true, no status message is printed
+//
+// @return     The executions in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame getTradeQuotes_impl(std::string filename,
+                                    unsigned long long bufferSize,
+                                    Rcpp::IntegerVector stockLocate,
+                                    std::string bookFile,
+                                    bool quiet) {
+  TradeQuotes trades;
+  if (!bookFile.empty()) trades.seed(readLastSnapshot(bookFile));
+
+  trades.replayFile(filename, bufferSize, quiet, MessageFilter::create(stockLocate, MARKET_ALL, TRADING_KEEP));
+
+  if (!quiet) Rcpp::Rcout << "\n[Converting] to data.table\n";
+  return trades.getDF();
+}
+
+// @brief      Returns the executions ('E', 'C', and 'P') of a session with the top of book
+//              of their stock before the execution as a dataframe
+//
+// @param[in]  session      The external pointer to the session
+// @param[in]  stockLocate  The stock locate codes to load, empty for all stocks
+// @param[in]  bookFile     The book file whose last snapshot seeds the book, empty for an empty book
+// @param[in]  quiet        If true, no status message is printed
+//
+// @return     The executions in a data.frame
+//
+// [[Rcpp::export]]
+Rcpp::DataFrame getSessionTradeQuotes_impl(SEXP session,
+                                           Rcpp::IntegerVector stockLocate,
+                                           std::string bookFile,
+                                           bool quiet) {
+  TradeQuotes trades;
+  if (!bookFile.empty()) trades.seed(readLastSnapshot(bookFile));
+  return getSessionMessagesTemplate(trades, session, 0, 0, stockLocate, MARKET_ALL, TRADING_KEEP, quiet);
+}
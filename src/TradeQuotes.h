@@ -0,0 +1,58 @@
+#ifndef TRADEQUOTES_H
+#define TRADEQUOTES_H
+
+#include <Rcpp.h>
+#include <vector>
+#include "BookReplay.h"
+#include "OrderBook.h"
+#include "Specifications.h"
+// [[Rcpp::plugins("cpp11")]]
+
+/**
+ * #################################################################
+ * TradeQuotes replays the order book (see OrderBook) and annotates each
+ *  execution ('E', 'C', and 'P') with the top of book of its stock
+ *  immediately before the execution, thus the prevailing quote of a trade
+ *  is found in the same pass (an as-of join on the book).
+ *
+ * Executions of orders that are not in the book (i.e., orders that were added
+ *  before the replayed messages) are skipped, as their side and price are unknown.
+ *  The book can be seeded with a snapshot (see BookSnapshots) instead.
+ *
+ * Consecutive modifications are applied in batches (see BookReplay),
+ *  the results do not change as the messages are still applied in order.
+ * #################################################################
+ */
+
+class TradeQuotes : public BookReplay {
+public:
+  TradeQuotes() : BookReplay({'A', 'F', 'E', 'C', 'X', 'D', 'U', 'P'},
+    {ITCH::POS::A, ITCH::POS::F, ITCH::POS::E, ITCH::POS::C,
+     ITCH::POS::X, ITCH::POS::D, ITCH::POS::U, ITCH::POS::P}) {}
+  // Functions
+  void reserve(unsigned long long) {} // few messages are executions, the columns grow as needed
+  Rcpp::DataFrame getDF();
+
+  // Members
+  Column<char>               type;
+  Column<unsigned long long> locateCode;
+  Column<unsigned long long> trackingNumber;
+  Column<unsigned long long> timestamp;
+  Column<unsigned long long> orderRef;
+  Column<unsigned long long> matchNumber;
+  Column<unsigned long long> stock; // raw 8 characters
+  Column<bool>               buy;   // the side of the resting order
+  Column<unsigned long long> shares;
+  Column<double>             price;
+  Column<double>             bidPrice; // NA if the side is empty
+  Column<unsigned long long> bidShares;
+  Column<double>             askPrice;
+  Column<unsigned long long> askShares;
+
+private:
+  void onApply(unsigned char* buf);
+  void addExecution(unsigned char* buf, BookOrder const& order, unsigned long long ref,
+                    unsigned long long match, unsigned long long execShares, unsigned int execPrice);
+};
+
+#endif //TRADEQUOTES_H
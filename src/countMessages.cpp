@@ -1,10 +1,46 @@
 #include "countMessages.h"
 
+/**
+ * @brief      Counts the complete messages of a buffer by their type, 
+ *              the messages are framed by the layout of their ITCH version
+ *
+ * @param      bufferPtr       The buffer
+ * @param[in]  thisBufferSize  The number of bytes in the buffer
+ * @param      inBufferIdx     The index of the first message, set to the index of the first 
+ *                               message that is not counted (a partial message)
+ * @param      count           The vector which holds the counts for each message type
+ */
+template <typename Layout>
+static void countBuffer(unsigned char* bufferPtr,
+                        unsigned long long thisBufferSize,
+                        unsigned long long& inBufferIdx,
+                        std::vector<unsigned long long>& count) {
+  // loop through the buffer by the index inBufferIdx
+  while (1) {
+    // if there is no partial message, this will be triggered
+    if (inBufferIdx >= thisBufferSize) break;
+    
+    const unsigned long long thisMsgLength = Layout::length(bufferPtr[inBufferIdx]);
+    // if there is a partial message, it is carried over to the next buffer
+    if (inBufferIdx + thisMsgLength > thisBufferSize) break;
+    
+    // count the messages, the time messages of ITCH 4.1 are not counted
+    if (Layout::isData(bufferPtr[inBufferIdx])) countMessageByType(count, bufferPtr[inBufferIdx]);
+    
+    // increase the index in the buffer
+    inBufferIdx += thisMsgLength; 
+    // two empty strings after each message...
+    inBufferIdx += 2;
+  }
+}
+
 /*
- * @brief      Counts the number of messages from a plain-text file
+ * @brief      Counts the number of messages from a plain-text file,
+ *              the ITCH version (5.0 or 4.1) is detected from the first messages
  *
- * @param[in]  filename    The filename to the plain-text file
- * @param[in]  bufferSize  The buffer size in bytes, defaults to 100MB
+ * @param[in]  filename    The filename to the plain-text file, "-" for stdin, or "| cmd" 
+ *                           for the output of a command (see InputFile)
+ * @param[in]  bufferSize  The buffer size in bytes, defaults to 100MB, 0 chooses the size automatically
  *
  * @return     A vector containing the number of messages per type
  */
@@ -12,66 +48,60 @@ std::vector<unsigned long long> countMessages(std::string filename,
                                               unsigned long long bufferSize) {
   
   // Open the file
-  FILE* infile;
-  infile = fopen(filename.c_str(), "rb");
-  if (infile == NULL) {
-    Rcpp::stop("File Error!\n");
-  }
+  InputFile infile(filename);
   
   std::vector<unsigned long long> count(ITCH::TYPES.size(), 0);
   
-  unsigned char* bufferPtr;
+  // 0 chooses the buffer size automatically, the buffer is reused between calls
+  // (up to ParseBuffer::MAX_RETAINED bytes, larger buffers are freed when the scope ends)
+  if (bufferSize == 0) bufferSize = getAutoBufferSize(filename);
   unsigned long long bufferCharSize = sizeof(char) * bufferSize;
-  bufferPtr = (unsigned char*) malloc(bufferCharSize);
+  ParseBuffer::Scope bufferScope;
+  unsigned char* bufferPtr = ParseBuffer::instance().get(bufferCharSize);
   
   unsigned long long thisBufferSize = 0;
-  unsigned long long curFilePtr;
+  // the bytes of a partial message at the end of the last buffer (see loadToMessages)
+  unsigned long long carryOver = 0;
   
-  // fill the buffer
-  while ((thisBufferSize = fread(bufferPtr, 1, bufferCharSize, infile)) > 0) {
+  // the version is detected from the first buffer
+  bool detected = false;
+  ITCHVersion version = ITCH_50;
+  
+  // measure the read throughput for the next automatic buffer size
+  unsigned long long bytesRead = 0;
+  double readSeconds = 0.0;
+  std::chrono::steady_clock::time_point readStart = std::chrono::steady_clock::now();
+  
+  // fill the buffer after the carried over bytes
+  while ((thisBufferSize = infile.read(&bufferPtr[carryOver], bufferCharSize - carryOver)) > 0) {
+    bytesRead   += thisBufferSize;
+    readSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - readStart).count();
+    thisBufferSize += carryOver;
+
     Rcpp::checkUserInterrupt();
     
-    // find the byte number, where file-pointer currently points to 
-    curFilePtr = ftell(infile);
+    if (!detected) {
+      version  = detectVersion(bufferPtr, thisBufferSize);
+      detected = true;
+    }
     
     // use the current buffer to read in the messages
     unsigned long long inBufferIdx = 2;
-    unsigned long long thisMsgLength;
-    
-    // loop through the buffer by the index inBufferIdx
-    while (1) {
-      // if there is no partial message, this will be triggered
-      if (inBufferIdx >= thisBufferSize) break;
-      
-      thisMsgLength = getMessageLength(bufferPtr[inBufferIdx]);
-      // if there is a partial message, go to the next buffer (gz-file pointer will be reset to match this!)
-      if (inBufferIdx > thisBufferSize - thisMsgLength) break;
-      
-      // count the messages
-      countMessageByType(count, bufferPtr[inBufferIdx]);
-      
-      // increase the index in the buffer
-      inBufferIdx += thisMsgLength; 
-      // two empty strings after each message...
-      inBufferIdx += 2;
+    if (version == ITCH_41) {
+      countBuffer<Layout41>(bufferPtr, thisBufferSize, inBufferIdx, count);
+    } else {
+      countBuffer<Layout50>(bufferPtr, thisBufferSize, inBufferIdx, count);
     }
     
-    // if the message doesn't fit, a new buffer will not solve the issue, as there is too little information for the given msg-length
-    if (inBufferIdx == 0) break;
+    // the last (partial) message starts 2 bytes before inBufferIdx (its length)
+    carryOver = thisBufferSize + 2 - inBufferIdx;
+    // if the message doesn't fit, a new buffer will not solve the issue
+    if (carryOver >= bufferCharSize) Rcpp::stop("The buffer is too small for a single message");
+    if (carryOver > 0) memmove(bufferPtr, &bufferPtr[inBufferIdx - 2], carryOver);
     
-    // reset the current fileptr if needed
-    // clear the remaining bits, the last partial message might be cut in two, thus reset the gz-file pointer
-    // remaining bits of the last message: curFilePtr - thisBufferSize + inBufferIdx - 2
-    if (thisBufferSize != inBufferIdx) {
-      fseek(infile, curFilePtr - thisBufferSize + inBufferIdx - 2, SEEK_SET);
-    } else {
-      // if the message perfectly ends, still set it back by 2, otherwise 2 bytes are skipped!
-      fseek(infile, curFilePtr - 2, SEEK_SET);
-    }
+    readStart = std::chrono::steady_clock::now();
   }
-  
-  free(bufferPtr);
-  fclose(infile);
+  recordThroughput(bytesRead, readSeconds);
   
   return count;
 }
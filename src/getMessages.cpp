@@ -4,7 +4,7 @@
  * @brief      Loads the messages from a file into the given messagetype (i.e., Trades, Orders, etc)
  *
  * @param      msg            The given messagetype (i.e., Trades, Orders, etc)
- * @param[in]  filename       The filename to a plain-text-file
+ * @param[in]  filename       The filename to a plain-text-file, "-" for stdin, or "| cmd"
  * @param[in]  startMsgCount  The start message count, the message (order) count at which we 
  *                              start to save the messages, the defaults to 0 (first message)
  * @param[in]  endMsgCount    The end message count, the message count at which we stop to 
@@ -12,17 +12,23 @@
  *                              substituted to all messages
  * @param[in]  bufferSize     The buffer size in bytes, defaults to 100MB
  * @param[in]  quiet          If true, no status message is printed, defaults to false
+ * @param[in]  filter         The filter of the messages (by stock, market session, and trading state, 
+ *                              see MessageFilter)
+ * @param[in]  arrow          If true, the data is moved into an Arrow stream (see ArrowBuilder)
  *
- * @return     A Rcpp::DataFrame containing the data 
+ * @return     A Rcpp::DataFrame containing the data, or an external pointer to the Arrow stream
  */
-Rcpp::DataFrame getMessagesTemplate(MessageType& msg,
-                                    std::string filename, 
-                                    unsigned long long startMsgCount,
-                                    unsigned long long endMsgCount,
-                                    unsigned long long bufferSize, 
-                                    bool quiet) {
+Rcpp::RObject getMessagesTemplate(MessageType& msg,
+                                  std::string filename, 
+                                  unsigned long long startMsgCount,
+                                  unsigned long long endMsgCount,
+                                  unsigned long long bufferSize, 
+                                  bool quiet,
+                                  MessageFilter filter,
+                                  bool arrow) {
 
   unsigned long long nMessages;
+  msg.tagTradingState = filter.getTradingMode() == TRADING_TAG;
 
   // check that the order is correct
   if (startMsgCount > endMsgCount) {
@@ -33,7 +39,14 @@ Rcpp::DataFrame getMessagesTemplate(MessageType& msg,
   }
   
   // if no max num given, count valid messages!
-  if (endMsgCount == 0ULL) {
+  // streams (stdin, commands, or R connections) can only be read once, thus they are not counted,
+  // the count by type is of no use if only some messages are loaded
+  if (endMsgCount == 0ULL && (InputFile::isStream(filename) || filter.isActive())) {
+    if (!quiet) Rcpp::Rcout << "[Counting]   skipped for " << 
+      (filter.isActive() ? "filtered messages" : "streams") << "\n";
+    endMsgCount = std::numeric_limits<unsigned long long>::max();
+    nMessages = 0;
+  } else if (endMsgCount == 0ULL) {
     if (!quiet) Rcpp::Rcout << "[Counting]   ";
     std::vector<unsigned long long> count = countMessages(filename, bufferSize);
     endMsgCount = msg.countValidMessages(count);
@@ -44,17 +57,28 @@ Rcpp::DataFrame getMessagesTemplate(MessageType& msg,
     nMessages = endMsgCount - startMsgCount + 1;
   }
   
-  if (!quiet) Rcpp::Rcout << nMessages << " messages found\n";
-
-  // Reserve the space for messages of type A and F 
-  msg.reserve(nMessages);
+  if (nMessages > 0) {
+    if (!quiet) Rcpp::Rcout << nMessages << " messages found\n";
+    
+    // Reserve the space for messages of type A and F 
+    msg.reserve(nMessages);
+  }
 
   // load the file into the msg object
   if (!quiet) Rcpp::Rcout << "[Loading]    ";
-  loadToMessages(filename, msg, startMsgCount, endMsgCount, bufferSize, quiet);
+  loadToMessages(filename, msg, startMsgCount, endMsgCount, bufferSize, quiet, filter);
 
-  // converting the messages to a data.frame
-  if (!quiet) Rcpp::Rcout << "\n[Converting] to data.table\n";
+  if (!quiet && getHugePageMode() != HUGEPAGES_OFF) {
+    MemoryStats stats = getMemoryStats();
+    Rcpp::Rcout << "\n[Memory]     " 
+                << stats.explicitBytes / 1e6    << " MB explicit huge pages, "
+                << stats.transparentBytes / 1e6 << " MB transparent huge pages, "
+                << stats.regularBytes / 1e6     << " MB regular pages";
+  }
+
+  // converting the messages to a data.frame, or handing the columns to Arrow
+  if (!quiet) Rcpp::Rcout << "\n[Converting] to " << (arrow ? "Arrow" : "data.table") << "\n";
+  if (arrow) return msg.getArrow();
   Rcpp::DataFrame retDF = msg.getDF();
   return retDF;
 }
@@ -64,25 +88,34 @@ Rcpp::DataFrame getMessagesTemplate(MessageType& msg,
 // 
 // Order Types considered are 'A' (add order) and 'F' (add order with MPID)
 //
-// @param[in]  filename       The filename to a plain-text-file
+// @param[in]  filename       The filename to a plain-text-file, "-" for stdin, or "| cmd"
 // @param[in]  startMsgCount  The start message count, the message (order) count at which we 
 //                              start to save the messages, the defaults to 0 (first message)
 // @param[in]  endMsgCount    The end message count, the message count at which we stop to 
 //                              stop to save the messages, defaults to 0, which will be 
 //                              substituted to all messages
 // @param[in]  bufferSize     The buffer size in bytes, defaults to 100MB
+// @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+// @param[in]  marketSession  The market session to load, 0 all, 1 pre-market, 2 regular, 3 post-market
+// @param[in]  tradingMode    The use of the trading state, 0 keep, 1 tag, 2 drop halted/paused/quoted stocks
+// @param[in]  arrow          If true, the orders are returned as an Arrow stream
 // @param[in]  quiet          If true, no status message is printed, defaults to false
 //
-// @return     The orders in a data.frame
+// @return     The orders in a data.frame, or an external pointer to the Arrow stream
 //
 // [[Rcpp::export]]
-Rcpp::DataFrame getOrders_impl(std::string filename,
-                               unsigned long long startMsgCount,
-                               unsigned long long endMsgCount,
-                               unsigned long long bufferSize,
-                               bool quiet) {
+Rcpp::RObject getOrders_impl(std::string filename,
+                             unsigned long long startMsgCount,
+                             unsigned long long endMsgCount,
+                             unsigned long long bufferSize,
+                             Rcpp::IntegerVector stockLocate,
+                             int marketSession,
+                             int tradingMode,
+                             bool arrow,
+                             bool quiet) {
   Orders orders;
-  Rcpp::DataFrame df = getMessagesTemplate(orders, filename, startMsgCount, endMsgCount, bufferSize, quiet);
+  Rcpp::RObject df = getMessagesTemplate(orders, filename, startMsgCount, endMsgCount, bufferSize, quiet, 
+                                         MessageFilter::create(stockLocate, marketSession, tradingMode), arrow);
   return df;  
 }
 
@@ -91,26 +124,37 @@ Rcpp::DataFrame getOrders_impl(std::string filename,
 // 
 // Trade Types considered are 'P', 'Q', and 'B' (Non Cross, Cross, and Broken)
 //
-// @param[in]  filename       The filename to a plain-text-file
+// @param[in]  filename       The filename to a plain-text-file, "-" for stdin, or "| cmd"
 // @param[in]  startMsgCount  The start message count, the message (order) count at which we 
 //                              start to save the messages, the defaults to 0 (first message)
 // @param[in]  endMsgCount    The end message count, the message count at which we stop to 
 //                              stop to save the messages, defaults to 0, which will be 
 //                              substituted to all messages
 // @param[in]  bufferSize     The buffer size in bytes, defaults to 100MB
+// @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+// @param[in]  marketSession  The market session to load, 0 all, 1 pre-market, 2 regular, 3 post-market
+// @param[in]  tradingMode    The use of the trading state, 0 keep, 1 tag, 2 drop halted/paused/quoted stocks
+// @param[in]  brokenMode     The use of the broken trades, 0 keep, 1 flag, 2 drop the broken trades
+// @param[in]  arrow          If true, the trades are returned as an Arrow stream
 // @param[in]  quiet          If true, no status message is printed, defaults to false
 //
-// @return     The trades in a data.frame
+// @return     The trades in a data.frame, or an external pointer to the Arrow stream
 //
 // [[Rcpp::export]]
-Rcpp::DataFrame getTrades_impl(std::string filename,
-                               unsigned long long startMsgCount,
-                               unsigned long long endMsgCount,
-                               unsigned long long bufferSize,
-                               bool quiet) {
+Rcpp::RObject getTrades_impl(std::string filename,
+                             unsigned long long startMsgCount,
+                             unsigned long long endMsgCount,
+                             unsigned long long bufferSize,
+                             Rcpp::IntegerVector stockLocate,
+                             int marketSession,
+                             int tradingMode,
+                             int brokenMode,
+                             bool arrow,
+                             bool quiet) {
   
-  Trades trades;
-  Rcpp::DataFrame df = getMessagesTemplate(trades, filename, startMsgCount, endMsgCount, bufferSize, quiet);
+  Trades trades(checkBrokenMode(brokenMode));
+  Rcpp::RObject df = getMessagesTemplate(trades, filename, startMsgCount, endMsgCount, bufferSize, quiet, 
+                                         MessageFilter::create(stockLocate, marketSession, tradingMode), arrow);
   return df;  
 }
 
@@ -118,24 +162,33 @@ Rcpp::DataFrame getTrades_impl(std::string filename,
 // 
 // Modification Types considered are 'E' (order executed), 'C' (order executed with price), 'X' (order cancelled), 'D' (order deleted), and 'U' (order replaced)
 //
-// @param[in]  filename       The filename to a plain-text-file
+// @param[in]  filename       The filename to a plain-text-file, "-" for stdin, or "| cmd"
 // @param[in]  startMsgCount  The start message count, the message (order) count at which we 
 //                              start to save the messages, the defaults to 0 (first message)
 // @param[in]  endMsgCount    The end message count, the message count at which we stop to 
 //                              stop to save the messages, defaults to 0, which will be 
 //                              substituted to all messages
 // @param[in]  bufferSize     The buffer size in bytes, defaults to 100MB
+// @param[in]  stockLocate    The stock locate codes to load, empty for all stocks
+// @param[in]  marketSession  The market session to load, 0 all, 1 pre-market, 2 regular, 3 post-market
+// @param[in]  tradingMode    The use of the trading state, 0 keep, 1 tag, 2 drop halted/paused/quoted stocks
+// @param[in]  arrow          If true, the modifications are returned as an Arrow stream
 // @param[in]  quiet          If true, no status message is printed, defaults to false
 //
-// @return     The modifications in a data.frame
+// @return     The modifications in a data.frame, or an external pointer to the Arrow stream
 // [[Rcpp::export]]
-Rcpp::DataFrame getModifications_impl(std::string filename,
-                                      unsigned long long startMsgCount,
-                                      unsigned long long endMsgCount,
-                                      unsigned long long bufferSize,
-                                      bool quiet) {
+Rcpp::RObject getModifications_impl(std::string filename,
+                                    unsigned long long startMsgCount,
+                                    unsigned long long endMsgCount,
+                                    unsigned long long bufferSize,
+                                    Rcpp::IntegerVector stockLocate,
+                                    int marketSession,
+                                    int tradingMode,
+                                    bool arrow,
+                                    bool quiet) {
   
   Modifications mods;
-  Rcpp::DataFrame df = getMessagesTemplate(mods, filename, startMsgCount, endMsgCount, bufferSize, quiet);
+  Rcpp::RObject df = getMessagesTemplate(mods, filename, startMsgCount, endMsgCount, bufferSize, quiet, 
+                                         MessageFilter::create(stockLocate, marketSession, tradingMode), arrow);
   return df;  
 }
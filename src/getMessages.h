@@ -7,18 +7,20 @@
 /**
  * ########################################
  * getX loads the contents of the 
- * file int a Rcpp::DataFrame
+ * file int a Rcpp::DataFrame (or an Arrow stream)
  * 
  * These functions are supposed to be called from the get_* functions of the RITCH Package
  * ########################################
  */ 
 
-Rcpp::DataFrame getMessagesTemplate(MessageType& msg,
-                                    std::string filename, 
-                                    unsigned long long startMsgCount = 0,
-                                    unsigned long long endMsgCount = 0,
-                                    unsigned long long bufferSize = 1e8,
-                                    bool quiet = false);
+Rcpp::RObject getMessagesTemplate(MessageType& msg,
+                                  std::string filename, 
+                                  unsigned long long startMsgCount = 0,
+                                  unsigned long long endMsgCount = 0,
+                                  unsigned long long bufferSize = 1e8,
+                                  bool quiet = false,
+                                  MessageFilter filter = MessageFilter(),
+                                  bool arrow = false);
 
 Rcpp::DataFrame getOrders(std::string filename, 
                           unsigned long long startMsgCount = 0,